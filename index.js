@@ -18,8 +18,8 @@
  * @fileoverview Entrypoint for Node.
  */
 
-import buildHarness from './src/harness/node-harness.js';
-export {buildHarness};
+import buildHarness, {wrapper16 as buildHarness16} from './src/harness/node-harness.js';
+export {buildHarness, buildHarness16};
 
 import buildRewriter from './src/harness/node-rewriter.js';
 export {buildRewriter};
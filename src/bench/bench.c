@@ -0,0 +1,151 @@
+/*
+ * Copyright 2021 Sam Thorogood. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+// Native benchmark runner, driven by bench.js. Usage: _bench <token|parse|validate> <runs> <files...>
+//
+// Reads every file up front, then parses all of them once per run (plus an untimed warmup). Prints
+// a single JSON object with the token count of one run and the time of each run in milliseconds.
+
+#define _POSIX_C_SOURCE 199309L  // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../core/token.h"
+#include "../core/parser.h"
+
+static int tokens;
+
+void blep_parser_callback() {
+  ++tokens;
+}
+
+int blep_parser_open(int type) {
+  return 0;
+}
+
+void blep_parser_close(int type) {
+  // ignore
+}
+
+static int read_file(const char *path, char **buf) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return -1;
+  }
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  // the tokenizer expects a trailing NULL
+  *buf = malloc(len + 1);
+  if (fread(*buf, 1, len, f) != (size_t) len) {
+    fclose(f);
+    return -1;
+  }
+  (*buf)[len] = 0;
+  fclose(f);
+  return len;
+}
+
+// tokenizes without the parser, so regexp/divide is never corrected
+static int run_token(char *buf, int len) {
+  int ret = blep_token_init(buf, len);
+  while (ret >= 0) {
+    ret = blep_token_next();
+    if (ret <= 0) {
+      break;
+    }
+    ++tokens;
+  }
+  return ret;
+}
+
+static int run_parse(char *buf, int len) {
+  int ret = blep_parser_init(buf, len);
+  if (ret >= 0) {
+    do {
+      ret = blep_parser_run();
+    } while (ret > 0);
+  }
+  return ret;
+}
+
+static int run_validate(char *buf, int len) {
+  return blep_validate(buf, len);
+}
+
+static double now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    fprintf(stderr, "usage: %s <token|parse|validate> <runs> <files...>\n", argv[0]);
+    return 1;
+  }
+
+  int (*run)(char *, int);
+  if (!strcmp(argv[1], "token")) {
+    run = run_token;
+  } else if (!strcmp(argv[1], "parse")) {
+    run = run_parse;
+  } else if (!strcmp(argv[1], "validate")) {
+    run = run_validate;
+  } else {
+    fprintf(stderr, "unknown mode: %s\n", argv[1]);
+    return 1;
+  }
+
+  int runs = atoi(argv[2]);
+  int count = argc - 3;
+  char **bufs = malloc(sizeof(char *) * count);
+  int *lens = malloc(sizeof(int) * count);
+  for (int i = 0; i < count; ++i) {
+    lens[i] = read_file(argv[3 + i], &bufs[i]);
+    if (lens[i] < 0) {
+      fprintf(stderr, "can't read: %s\n", argv[3 + i]);
+      return 1;
+    }
+  }
+
+  int errors = 0;
+  int run_tokens = 0;
+  printf("{\"samples\":[");
+
+  for (int r = -1; r < runs; ++r) {
+    tokens = 0;
+    errors = 0;
+    double start = now_ms();
+    for (int i = 0; i < count; ++i) {
+      if (run(bufs[i], lens[i]) < 0) {
+        ++errors;
+      }
+    }
+    double ms = now_ms() - start;
+
+    run_tokens = tokens;
+    if (r >= 0) {
+      printf("%s%.4f", r ? "," : "", ms);
+    }
+  }
+
+  printf("],\"tokens\":%d,\"errors\":%d}\n", run_tokens, errors);
+  return 0;
+}
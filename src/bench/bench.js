@@ -0,0 +1,89 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+/**
+ * @fileoverview Benchmarks the parser over the pinned corpus. Prints one JSON object per line: a
+ * record per runner, mode and corpus entry, then a summary per runner and mode.
+ *
+ * Usage: node bench.js [--runs N] [--native path/to/_bench] [--modes a,b] [extra files or dirs...]
+ */
+
+import {buildCorpus} from './corpus.js';
+import {nativeModes, runNative, runWasm, summarize, totalBytes, wasmModes} from './runner.js';
+
+let runs = 10;
+let native = '';
+/** @type {string[]?} */
+let modes = null;
+/** @type {string[]} */
+const extra = [];
+
+const args = process.argv.slice(2);
+while (args.length) {
+  const arg = /** @type {string} */ (args.shift());
+  if (arg === '--runs') {
+    runs = +(args.shift() ?? runs);
+  } else if (arg === '--native') {
+    native = args.shift() ?? '';
+  } else if (arg === '--modes') {
+    modes = (args.shift() ?? '').split(',');
+  } else {
+    extra.push(arg);
+  }
+}
+
+/** @type {[string, string[], (mode: string, files: string[]) => Promise<import('./runner.js').Result>|import('./runner.js').Result][]} */
+const runners = [
+  ['native', native ? nativeModes : [], (mode, files) => runNative(native, mode, files, runs)],
+  ['wasm', wasmModes, (mode, files) => runWasm(mode, files, runs)],
+];
+
+const {entries, cleanup} = buildCorpus(extra);
+try {
+  for (const [runner, runnerModes, run] of runners) {
+    for (const mode of runnerModes) {
+      if (modes && !modes.includes(mode)) {
+        continue;
+      }
+
+      let bytes = 0;
+      let ms = 0;
+      let tokens = 0;
+      for (const {name, files} of entries) {
+        const entryBytes = totalBytes(files);
+        const summary = summarize(await run(mode, files), entryBytes);
+        console.log(JSON.stringify({runner, mode, entry: name, files: files.length, ...summary}));
+
+        bytes += entryBytes;
+        ms += summary.ms.mean;
+        tokens += summary.tokens;
+      }
+
+      const seconds = ms / 1e3;
+      console.log(JSON.stringify({
+        runner,
+        mode,
+        summary: true,
+        bytes,
+        ms,
+        mbps: (bytes / 1e6) / seconds,
+        tokensPerSecond: tokens / seconds,
+      }));
+    }
+  }
+} finally {
+  cleanup();
+}
@@ -0,0 +1,10 @@
+#!/bin/bash
+
+cd "${BASH_SOURCE%/*}" || exit
+
+set -eu
+
+# nb. built with optimizations, unlike the test binaries
+clang -O2 bench.c ../core/*.c -o _bench
+node bench.js --native ./_bench "$@"
+rm _bench
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+/**
+ * @fileoverview Pinned benchmark corpus. Each entry is a named set of files which is timed as a
+ * whole, so tiny inputs (like test262's) are measured together.
+ */
+
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+
+/**
+ * @typedef {{name: string, files: string[]}} Entry
+ */
+
+const root = new URL('../..', import.meta.url).pathname;
+
+/**
+ * A module which exercises most of the grammar. Identifiers vary by index so interning and
+ * resolution don't see the same names each time.
+ *
+ * @param {number} i
+ * @return {string}
+ */
+const moduleChunk = (i) => `
+import {a${i}, b${i} as c${i}} from './dep${i % 17}.js';
+export * from "./re${i % 5}.js";
+
+/**
+ * Block comment ${i}.
+ */
+export class Thing${i} extends Base {
+  static #count = ${i};
+  constructor({x = 1, y: [z, ...rest]} = {}) {
+    super();
+    this.value = x / 2 + z * 0x${(i & 0xffff).toString(16)} - rest.length;
+  }
+  async *items() {
+    for await (const item of this.source) {
+      yield item?.value ?? /re${i}[a-z]+/gi.test(\`\${item}\`);
+    }
+  }
+  get size() { return Thing${i}.#count; }
+}
+
+export const fn${i} = async (a, {b, c = () => ({d: a})}) => {
+  const s = 'str\\'ing ${i}' + "other" + \`template \${a + \`nested \${b}\`} end\`;
+  label${i}: for (let j = 0; j < ${i}; ++j) {
+    if (j % 3) continue label${i}; else break;
+  }
+  return a ? b : c?.(s, ...[1, 2.5e3, 10n]);
+};
+`;
+
+/**
+ * @param {string} dir
+ * @return {string[]}
+ */
+const jsFiles = (dir) => {
+  if (!fs.existsSync(dir)) {
+    return [];
+  }
+  return fs.readdirSync(dir).filter((name) => name.endsWith('.js')).sort().map((name) => path.join(dir, name));
+};
+
+/**
+ * Writes generated inputs into a temporary directory, which the caller should remove.
+ *
+ * @param {string} dir
+ * @return {Entry[]}
+ */
+function generated(dir) {
+  let source = '';
+  for (let i = 0; source.length < (2 << 20); ++i) {
+    source += moduleChunk(i);
+  }
+  const file = path.join(dir, 'generated-module.js');
+  fs.writeFileSync(file, source);
+  return [{name: 'generated/module', files: [file]}];
+}
+
+/**
+ * Builds the corpus: test262's passing inputs (each directory as a single entry), every file
+ * found in "src/bench/corpus" (e.g., real-world libraries), generated inputs, and any extra paths.
+ *
+ * @param {string[]} extra files or directories
+ * @return {{entries: Entry[], cleanup: () => void}}
+ */
+export function buildCorpus(extra = []) {
+  /** @type {Entry[]} */
+  const entries = [];
+
+  for (const name of ['pass', 'pass-explicit']) {
+    const files = jsFiles(path.join(root, 'node_modules/test262-parser-tests', name));
+    if (files.length) {
+      entries.push({name: `test262/${name}`, files});
+    } else {
+      console.warn(`missing test262-parser-tests/${name}, skipping`);
+    }
+  }
+
+  for (const file of jsFiles(path.join(root, 'src/bench/corpus'))) {
+    entries.push({name: `corpus/${path.basename(file)}`, files: [file]});
+  }
+
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'gumnut-bench-'));
+  entries.push(...generated(dir));
+
+  for (const p of extra) {
+    const files = fs.statSync(p).isDirectory() ? jsFiles(p) : [p];
+    entries.push({name: path.relative(process.cwd(), p), files});
+  }
+
+  return {
+    entries,
+    cleanup() {
+      fs.rmSync(dir, {recursive: true});
+    },
+  };
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+/**
+ * @fileoverview Generates JS inputs of a given size and shape, for scaling tests. Inputs are
+ * written in chunks, so they can be larger than a JS string allows.
+ *
+ * Usage: node generate.js <shape> <megabytes> <output>
+ */
+
+import * as fs from 'fs';
+
+/**
+ * Chunk builders for each shape. Each is repeated (with a growing index) until the output reaches
+ * its size, so every shape is linear by construction and any slowdown is the parser's.
+ *
+ * @type {{[shape: string]: (i: number) => string}}
+ */
+export const shapes = {
+
+  // one long line, as in a minified bundle
+  minified(i) {
+    return `var a${i}=function(b,c){return b+c*2||[1,2].map(d=>d>1?d:-d)},e${i}={f:1,"g":a${i}(2,3)};` +
+        `if(e${i}.f)for(var h=0;h<9;++h)e${i}[h]=h/2/1;else throw new Error("x"+h);`;
+  },
+
+  // mostly comments, with a little code between
+  comments(i) {
+    return `// line comment ${i}, which goes on for a while to take up space in the file\n` +
+        `/**\n * Block comment ${i}.\n *\n * @param {string} a\n * @return {number}\n */\n` +
+        `/* adjacent */ let x${i} = /* inline */ 1; // trailing\n`;
+  },
+
+  // arrow functions nested inside each other, each taking a destructuring pattern
+  arrows(i) {
+    const depth = 24;
+    let out = `const f${i} = `;
+    for (let j = 0; j < depth; ++j) {
+      out += `({a${j}, b: [c${j}, {d${j} = ${j}}], ...e${j}}) => `;
+    }
+    out += `a0 + c${depth - 1};\n`;
+    for (let j = 0; j < depth; ++j) {
+      out += `[{x${j}}, y${j} = () => ({z${j}}) => z${j}] = `;
+    }
+    return out + `g${i};\n`;
+  },
+
+  // long templates with many holes
+  templates(i) {
+    let out = `const t${i} = \``;
+    for (let j = 0; j < 200; ++j) {
+      out += `text ${j} \${a${j} + \`inner \${b}\`} `;
+    }
+    return out + '`;\n';
+  },
+
+  // brackets nested just below the tokenizer's stack limit (STACK_SIZE, 256)
+  brackets(i) {
+    const depth = 120;
+    return `x${i} = ${'(['.repeat(depth)}${i}${'])'.repeat(depth)};\n`;
+  },
+
+};
+
+/**
+ * Writes an input of at least this many bytes (less one chunk) and this shape to the file.
+ *
+ * @param {string} shape
+ * @param {number} bytes
+ * @param {string} file
+ * @return {number} bytes written
+ */
+export function generateFile(shape, bytes, file) {
+  const chunk = shapes[shape];
+  if (!chunk) {
+    throw new Error(`unknown shape: ${shape}`);
+  }
+
+  const fd = fs.openSync(file, 'w');
+  let written = 0;
+  try {
+    /** @type {string[]} */
+    let pending = [];
+    let pendingLength = 0;
+
+    for (let i = 0; written + pendingLength < bytes; ++i) {
+      const part = chunk(i);
+      pending.push(part);
+      pendingLength += part.length;  // all ASCII
+
+      if (pendingLength >= (1 << 20)) {
+        written += fs.writeSync(fd, pending.join(''));
+        pending = [];
+        pendingLength = 0;
+      }
+    }
+    written += fs.writeSync(fd, pending.join(''));
+  } finally {
+    fs.closeSync(fd);
+  }
+  return written;
+}
+
+if (process.argv[1] === new URL(import.meta.url).pathname) {
+  const [shape, megabytes, file] = process.argv.slice(2);
+  if (!file) {
+    console.warn(`usage: generate.js <${Object.keys(shapes).join('|')}> <megabytes> <output>`);
+    process.exit(1);
+  }
+  generateFile(shape, +megabytes * (1 << 20), file);
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+/**
+ * @fileoverview Measures memory over a mixed workload: mostly small files, with an occasional
+ * large one, as a long-lived dev server sees. Each high-water mark runs in its own process so RSS
+ * is comparable, and prints one JSON object.
+ *
+ * Usage: node memory.js [--files N] [--large MB] [--every N] [--marks MB,MB...]
+ */
+
+import buildHarness from '../harness/node-harness.js';
+import {generateFile} from './generate.js';
+import * as child_process from 'child_process';
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+import {performance} from 'perf_hooks';
+
+const options = {
+  files: 200,
+  large: 32,  // MB
+  every: 50,
+  marks: '0,8',  // MB, zero never recycles
+  child: '',
+};
+
+const args = process.argv.slice(2);
+while (args.length) {
+  const arg = (args.shift() ?? '').replace(/^--/, '');
+  if (!(arg in options)) {
+    throw new Error(`unknown arg: --${arg}`);
+  }
+  const value = args.shift() ?? '';
+  // @ts-ignore
+  options[arg] = typeof options[arg] === 'number' ? +value : value;
+}
+
+if (options.child) {
+  // runs the workload over prepared files: {mark, small, large}
+  const {mark, small, large} = JSON.parse(options.child);
+  const harness = await buildHarness({highWaterMark: mark * (1 << 20)});
+
+  let rssPeak = 0;
+  const start = performance.now();
+  for (let i = 0; i < options.files; ++i) {
+    const source = fs.readFileSync(i % options.every === options.every - 1 ? large : small);
+    harness.prepare(source.length).set(source);
+    harness.run();
+    rssPeak = Math.max(rssPeak, process.memoryUsage().rss);
+  }
+  const ms = performance.now() - start;
+
+  const {current, peak, recycles} = harness.memory();
+  console.log(JSON.stringify({
+    highWaterMark: mark,
+    files: options.files,
+    ms,
+    rssPeak,
+    rssFinal: process.memoryUsage().rss,
+    wasmPeak: peak,
+    wasmFinal: current,
+    recycles,
+  }));
+} else {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'gumnut-memory-'));
+  try {
+    const small = path.join(dir, 'small.js');
+    const large = path.join(dir, 'large.js');
+    generateFile('minified', 64 << 10, small);
+    generateFile('minified', options.large * (1 << 20), large);
+
+    for (const mark of options.marks.split(',').map(Number)) {
+      const child = JSON.stringify({mark, small, large});
+      const out = child_process.execFileSync(process.execPath, [
+        new URL(import.meta.url).pathname,
+        '--files', String(options.files),
+        '--every', String(options.every),
+        '--child', child,
+      ], {encoding: 'utf-8'});
+      process.stdout.write(out);
+    }
+  } finally {
+    fs.rmSync(dir, {recursive: true});
+  }
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2021 Sam Thorogood. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+// Profiles one parse of a file natively. Usage: _profile <file> [folded output]
+//
+// Prints time and calls per grammar and tokenizer function, and optionally writes folded stacks
+// for flame graphs (e.g., `flamegraph.pl out.folded > out.svg`).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../core/token.h"
+#include "../core/parser.h"
+#include "../core/profile.h"
+
+#ifndef BLEP_PROFILE
+#error "build with -DBLEP_PROFILE"
+#endif
+
+void blep_parser_callback() {
+  // ignore
+}
+
+int blep_parser_open(int type) {
+  return 0;
+}
+
+void blep_parser_close(int type) {
+  // ignore
+}
+
+static int run(char *buf, int len) {
+  int ret = blep_parser_init(buf, len);
+  if (ret >= 0) {
+    do {
+      ret = blep_parser_run();
+    } while (ret > 0);
+  }
+  return ret;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <file> [folded output]\n", argv[0]);
+    return 1;
+  }
+
+  FILE *f = fopen(argv[1], "rb");
+  if (!f) {
+    fprintf(stderr, "can't read: %s\n", argv[1]);
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char *buf = malloc(len + 1);
+  len = fread(buf, 1, len, f);
+  buf[len] = 0;
+  fclose(f);
+
+  // warm up, as each run resets the profile
+  run(buf, len);
+  int ret = run(buf, len);
+  if (ret < 0) {
+    fprintf(stderr, "parse error: %d\n", ret);
+  }
+
+  blep_profile_report(stdout);
+
+  if (argc > 2) {
+    FILE *out = fopen(argv[2], "w");
+    if (!out) {
+      fprintf(stderr, "can't write: %s\n", argv[2]);
+      return 1;
+    }
+    blep_profile_folded(out);
+    fclose(out);
+  }
+  return ret < 0 ? 1 : 0;
+}
@@ -0,0 +1,11 @@
+#!/bin/bash
+
+# Usage: profile.sh <file.js> [out.folded]
+
+set -eu
+
+DIR="${BASH_SOURCE%/*}"
+clang -O2 -DBLEP_PROFILE "${DIR}/profile.c" "${DIR}"/../core/*.c -o "${DIR}/_profile"
+"${DIR}/_profile" "$@" || STATUS=$?
+rm "${DIR}/_profile"
+exit ${STATUS-0}
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+/**
+ * @fileoverview Runs the parser over sets of files, natively (via the `_bench` binary) or as wasm,
+ * and summarizes timings.
+ */
+
+import buildHarness from '../harness/node-harness.js';
+import buildImportsRewriter from '../tool/imports/lib.js';
+import * as child_process from 'child_process';
+import * as fs from 'fs';
+import {performance} from 'perf_hooks';
+
+/**
+ * @typedef {{samples: number[], tokens: number, errors: number}} Result
+ * @typedef {{
+ *   bytes: number,
+ *   tokens: number,
+ *   errors: number,
+ *   runs: number,
+ *   ms: {mean: number, stddev: number, min: number},
+ *   mbps: number,
+ *   mbpsStddev: number,
+ *   tokensPerSecond: number,
+ * }} Summary
+ */
+
+export const nativeModes = ['token', 'parse', 'validate'];
+export const wasmModes = ['parse', 'validate', 'callback', 'imports'];
+
+/**
+ * @param {string[]} files
+ * @return {number}
+ */
+export function totalBytes(files) {
+  return files.reduce((total, file) => total + fs.statSync(file).size, 0);
+}
+
+/**
+ * Runs the native benchmark binary, which must already be built.
+ *
+ * @param {string} binary
+ * @param {string} mode "token" (no parser), "parse" or "validate"
+ * @param {string[]} files
+ * @param {number} runs
+ * @return {Result}
+ */
+export function runNative(binary, mode, files, runs) {
+  const out = child_process.execFileSync(binary, [mode, String(runs), ...files], {
+    encoding: 'utf-8',
+    maxBuffer: 1 << 20,
+  });
+  return JSON.parse(out);
+}
+
+/**
+ * Runs the wasm parser. Each run parses every file once, after one untimed warmup. Modes are:
+ *   - "parse": counts tokens in an otherwise empty callback
+ *   - "validate": checks syntax with the build without hooks, so doesn't count tokens
+ *   - "callback": reads every token's type, special and string in the callback
+ *   - "imports": rewrites imports with an identity resolver, discarding output
+ *
+ * @param {string} mode
+ * @param {string[]} files
+ * @param {number} runs
+ * @return {Promise<Result>}
+ */
+export async function runWasm(mode, files, runs) {
+  const sources = files.map((file) => fs.readFileSync(file));
+
+  /** @type {(i: number) => void} */
+  let once;
+  let tokens = 0;
+
+  if (mode === 'imports') {
+    const rewrite = await buildImportsRewriter(() => (specifier) => specifier, {cache: null});
+    const discard = () => {};
+    once = (i) => rewrite(files[i], discard);
+  } else {
+    const harness = await buildHarness();
+    const {token} = harness;
+
+    /** @type {() => void} */
+    let callback;
+    if (mode === 'parse') {
+      callback = () => {
+        ++tokens;
+      };
+    } else if (mode === 'validate') {
+      callback = () => {};
+    } else if (mode === 'callback') {
+      let sink = 0;
+      callback = () => {
+        ++tokens;
+        sink += token.type() + token.special() + token.string().length;
+      };
+    } else {
+      throw new Error(`unknown mode: ${mode}`);
+    }
+
+    once = (i) => {
+      harness.prepare(sources[i].length).set(sources[i]);
+      if (mode === 'validate') {
+        harness.validate();
+        return;
+      }
+      harness.handle({callback});
+      harness.run();
+    };
+  }
+
+  /** @type {number[]} */
+  const samples = [];
+  let runTokens = 0;
+  let errors = 0;
+
+  for (let r = -1; r < runs; ++r) {
+    tokens = 0;
+    errors = 0;
+    const start = performance.now();
+    for (let i = 0; i < files.length; ++i) {
+      try {
+        once(i);
+      } catch (e) {
+        ++errors;
+      }
+    }
+    const ms = performance.now() - start;
+
+    runTokens = tokens;
+    if (r >= 0) {
+      samples.push(ms);
+    }
+  }
+
+  return {samples, tokens: runTokens, errors};
+}
+
+/**
+ * @param {number[]} values
+ * @return {{mean: number, stddev: number}}
+ */
+function meanStddev(values) {
+  const mean = values.reduce((a, b) => a + b, 0) / values.length;
+  const variance = values.reduce((a, b) => a + (b - mean) ** 2, 0) / Math.max(1, values.length - 1);
+  return {mean, stddev: Math.sqrt(variance)};
+}
+
+/**
+ * @param {Result} result
+ * @param {number} bytes
+ * @return {Summary}
+ */
+export function summarize({samples, tokens, errors}, bytes) {
+  const ms = meanStddev(samples);
+  const mbps = meanStddev(samples.map((sample) => (bytes / 1e6) / (sample / 1e3)));
+
+  return {
+    bytes,
+    tokens,
+    errors,
+    runs: samples.length,
+    ms: {...ms, min: Math.min(...samples)},
+    mbps: mbps.mean,
+    mbpsStddev: mbps.stddev,
+    tokensPerSecond: tokens / (ms.mean / 1e3),
+  };
+}
+
+/**
+ * Fits the exponent k of time ~ size^k by least squares over log-log points. Linear growth gives
+ * a slope near 1.
+ *
+ * @param {{size: number, ms: number}[]} points
+ * @return {number}
+ */
+export function fitSlope(points) {
+  const xs = points.map(({size}) => Math.log(size));
+  const ys = points.map(({ms}) => Math.log(ms));
+  const mx = xs.reduce((a, b) => a + b, 0) / xs.length;
+  const my = ys.reduce((a, b) => a + b, 0) / ys.length;
+
+  let num = 0;
+  let den = 0;
+  for (let i = 0; i < xs.length; ++i) {
+    num += (xs[i] - mx) * (ys[i] - my);
+    den += (xs[i] - mx) ** 2;
+  }
+  return num / den;
+}
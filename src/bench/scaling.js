@@ -0,0 +1,105 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+/**
+ * @fileoverview Times parsing of generated inputs at doubling sizes for each shape, and flags any
+ * shape which grows worse than linearly. Prints one JSON object per shape and a plot of time per
+ * megabyte (flat when linear) to stderr. Exits with failure if any shape is flagged.
+ *
+ * Usage: node scaling.js [--native path/to/_bench] [--min MB] [--max MB] [--runs N]
+ *     [--threshold K] [--shapes a,b]
+ */
+
+import {generateFile, shapes} from './generate.js';
+import {fitSlope, runNative, runWasm, summarize} from './runner.js';
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+
+let native = '';
+let min = 1;
+let max = 64;
+let runs = 3;
+let threshold = 1.2;
+let names = Object.keys(shapes);
+
+const args = process.argv.slice(2);
+while (args.length) {
+  const arg = args.shift();
+  const value = args.shift() ?? '';
+  switch (arg) {
+    case '--native':
+      native = value;
+      break;
+    case '--min':
+      min = +value;
+      break;
+    case '--max':
+      max = +value;
+      break;
+    case '--runs':
+      runs = +value;
+      break;
+    case '--threshold':
+      threshold = +value;
+      break;
+    case '--shapes':
+      names = value.split(',');
+      break;
+    default:
+      throw new Error(`unknown arg: ${arg}`);
+  }
+}
+
+const plotWidth = 60;
+const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'gumnut-scaling-'));
+let flagged = 0;
+
+try {
+  for (const shape of names) {
+    const file = path.join(dir, `${shape}.js`);
+
+    /** @type {{size: number, ms: number, mbps: number, errors: number}[]} */
+    const points = [];
+    for (let mb = min; mb <= max; mb *= 2) {
+      const size = generateFile(shape, mb * (1 << 20), file);
+      const result = native ? runNative(native, 'parse', [file], runs) : await runWasm('parse', [file], runs);
+      const {ms, mbps, errors} = summarize(result, size);
+      points.push({size, ms: ms.min, mbps, errors});
+    }
+    fs.rmSync(file);
+
+    const slope = fitSlope(points);
+    const superLinear = slope > threshold;
+    if (superLinear) {
+      ++flagged;
+    }
+    console.log(JSON.stringify({shape, runner: native ? 'native' : 'wasm', slope, superLinear, points}));
+
+    // plot ms/MB against size; this is flat for linear growth
+    const perMB = points.map(({size, ms}) => ms / (size / (1 << 20)));
+    const scale = plotWidth / Math.max(...perMB);
+    console.warn(`${shape} (slope=${slope.toFixed(3)}${superLinear ? ', SUPER-LINEAR' : ''})`);
+    points.forEach(({size}, i) => {
+      const label = `${(size / (1 << 20)).toFixed(0)}MB`.padStart(7);
+      console.warn(`${label} | ${'#'.repeat(Math.max(1, Math.round(perMB[i] * scale)))} ${perMB[i].toFixed(2)}ms/MB`);
+    });
+  }
+} finally {
+  fs.rmSync(dir, {recursive: true});
+}
+
+process.exit(flagged ? 1 : 0);
@@ -0,0 +1,10 @@
+#!/bin/bash
+
+cd "${BASH_SOURCE%/*}" || exit
+
+set -eu
+
+clang -O2 bench.c ../core/*.c -o _bench
+node scaling.js --native ./_bench "$@" || STATUS=$?
+rm _bench
+exit ${STATUS-0}
@@ -0,0 +1,79 @@
+#include <stdint.h>
+#include <string.h>
+#include "arena.h"
+
+#ifdef EMSCRIPTEN
+#include <emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+#define ARENA_ALIGN   8
+#define ARENA_PAGE    65536
+
+static char *arena_at;
+static char *arena_end;
+static void **arena_kept;   // owner's pointer to a block moved to the start of each arena
+static int arena_kept_size;
+
+// ensures size bytes are available at arena_at
+static int arena_reserve(int size) {
+  char *want = arena_at + size;
+#ifdef __wasm__
+  // the arena always runs to the end of memory, so just grow it
+  uintptr_t limit = __builtin_wasm_memory_size(0) * ARENA_PAGE;
+  if ((uintptr_t) want > limit) {
+    int pages = ((uintptr_t) want - limit + ARENA_PAGE - 1) / ARENA_PAGE;
+    if (__builtin_wasm_memory_grow(0, pages) < 0) {
+      return 0;
+    }
+  }
+  return 1;
+#else
+  return arena_at && want <= arena_end;
+#endif
+}
+
+// sets up the arena at p for size bytes (in Web Assembly, size is ignored and memory is grown),
+// moving any kept block to its start
+EMSCRIPTEN_KEEPALIVE
+void blep_arena_init(void *p, int size) {
+  arena_at = (char *) (((uintptr_t) p + ARENA_ALIGN - 1) & ~(uintptr_t) (ARENA_ALIGN - 1));
+  arena_end = (char *) p + size;
+
+  if (arena_kept && *arena_kept) {
+    void *from = *arena_kept;
+    void *to = blep_arena_alloc(arena_kept_size);
+    if (to) {
+      memmove(to, from, arena_kept_size);  // nb. may overlap, if the input moved over it
+    }
+    *arena_kept = to;
+  }
+}
+
+// keeps size bytes at *block (allocated here) across blep_arena_init, which moves them and updates
+// *block, or sets it to NULL if they don't fit; pass NULL to keep nothing
+void blep_arena_keep(void **block, int size) {
+  arena_kept = block;
+  arena_kept_size = size;
+}
+
+// allocates until the next blep_arena_init, or returns NULL
+EMSCRIPTEN_KEEPALIVE
+void *blep_arena_alloc(int size) {
+  if (size < 0 || !arena_reserve(size)) {
+    return 0;
+  }
+  char *out = arena_at;
+  arena_at += (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+  return out;
+}
+
+// returns temporary space, valid until the next alloc or scratch, or returns NULL
+EMSCRIPTEN_KEEPALIVE
+void *blep_arena_scratch(int size) {
+  if (size < 0 || !arena_reserve(size)) {
+    return 0;
+  }
+  return arena_at;
+}
@@ -0,0 +1,14 @@
+#ifndef __BLEP_ARENA_H
+#define __BLEP_ARENA_H
+
+// Working memory for features that produce output (cooked strings, tables, rewritten source). It
+// should sit after the input, and is reset for every input: nothing allocated here outlives a parse,
+// except one kept block, which is moved to the start of the next arena. The previous arena must
+// still be readable (but may overlap the next one) when it's set up.
+
+void blep_arena_init(void *, int);
+void *blep_arena_alloc(int);
+void *blep_arena_scratch(int);
+void blep_arena_keep(void **, int);
+
+#endif//__BLEP_ARENA_H
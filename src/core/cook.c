@@ -0,0 +1,248 @@
+#include <string.h>
+#include "cook.h"
+
+// Cooks string and template literals into their value (i.e., removes quotes and escapes). The
+// output is never longer than the input, in bytes for UTF-8 and in units for UTF-16.
+
+static inline int cook_hex(blep_char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// reads `XXXX` or `{X...}` after "\u", returning the code point or -1
+static inline int cook_unicode(blep_char **pp, blep_char *end) {
+  blep_char *p = *pp;
+  int cp = 0;
+
+  if (p < end && *p == '{') {
+    ++p;
+    int digits = 0;
+    while (p < end && *p != '}') {
+      int v = cook_hex(*p++);
+      if (v < 0 || (cp = (cp << 4) | v) > 0x10ffff) {
+        return -1;
+      }
+      ++digits;
+    }
+    if (p == end || !digits) {
+      return -1;
+    }
+    *pp = p + 1;
+    return cp;
+  }
+
+  if (end - p < 4) {
+    return -1;
+  }
+  for (int i = 0; i < 4; ++i) {
+    int v = cook_hex(p[i]);
+    if (v < 0) {
+      return -1;
+    }
+    cp = (cp << 4) | v;
+  }
+  *pp = p + 4;
+  return cp;
+}
+
+static inline blep_char *cook_emit(blep_char *out, int cp) {
+#ifdef BLEP_UTF16
+  if (cp >= 0x10000) {
+    cp -= 0x10000;
+    *out++ = 0xd800 | (cp >> 10);
+    *out++ = 0xdc00 | (cp & 0x3ff);
+  } else {
+    *out++ = cp;
+  }
+#else
+  // nb. lone surrogates are emitted as-is (WTF-8), and will be replaced when decoded
+  if (cp < 0x80) {
+    *out++ = cp;
+  } else if (cp < 0x800) {
+    *out++ = 0xc0 | (cp >> 6);
+    *out++ = 0x80 | (cp & 0x3f);
+  } else if (cp < 0x10000) {
+    *out++ = 0xe0 | (cp >> 12);
+    *out++ = 0x80 | ((cp >> 6) & 0x3f);
+    *out++ = 0x80 | (cp & 0x3f);
+  } else {
+    *out++ = 0xf0 | (cp >> 18);
+    *out++ = 0x80 | ((cp >> 12) & 0x3f);
+    *out++ = 0x80 | ((cp >> 6) & 0x3f);
+    *out++ = 0x80 | (cp & 0x3f);
+  }
+#endif
+  return out;
+}
+
+// cooks the inner part of a string or template into out, returning its length or an error
+int blep_cook(blep_char *p, int len, blep_char *out) {
+  blep_char *end = p + len;
+  blep_char *start = out;
+
+  // fast path: find the first escape (or CR, which only appears in templates)
+  blep_char *first = p;
+  while (first < end && *first != '\\' && *first != '\r') {
+    ++first;
+  }
+  memcpy(out, p, (first - p) * sizeof(blep_char));
+  out += (first - p);
+  p = first;
+
+  while (p < end) {
+    blep_char c = *p++;
+
+    if (c == '\r') {
+      // templates normalize CRLF and CR to LF
+      *out++ = '\n';
+      if (p < end && *p == '\n') {
+        ++p;
+      }
+      continue;
+    } else if (c != '\\') {
+      *out++ = c;
+      continue;
+    } else if (p == end) {
+      return ERROR__UNEXPECTED;
+    }
+
+    c = *p++;
+    switch (c) {
+      case 'b':
+        *out++ = '\b';
+        continue;
+
+      case 'f':
+        *out++ = '\f';
+        continue;
+
+      case 'n':
+        *out++ = '\n';
+        continue;
+
+      case 'r':
+        *out++ = '\r';
+        continue;
+
+      case 't':
+        *out++ = '\t';
+        continue;
+
+      case 'v':
+        *out++ = '\v';
+        continue;
+
+      case '\r':
+        // line continuation
+        if (p < end && *p == '\n') {
+          ++p;
+        }
+        continue;
+
+      case '\n':
+        continue;
+
+      case 'x': {
+        int hi = (end - p >= 2) ? cook_hex(p[0]) : -1;
+        int lo = (hi >= 0) ? cook_hex(p[1]) : -1;
+        if (lo < 0) {
+          return ERROR__UNEXPECTED;
+        }
+        p += 2;
+        out = cook_emit(out, (hi << 4) | lo);
+        continue;
+      }
+
+      case 'u': {
+        int cp = cook_unicode(&p, end);
+        if (cp < 0) {
+          return ERROR__UNEXPECTED;
+        }
+#ifndef BLEP_UTF16
+        // join an escaped surrogate pair, as UTF-8 can't represent them separately
+        if (cp >= 0xd800 && cp < 0xdc00 && end - p >= 2 && p[0] == '\\' && p[1] == 'u') {
+          blep_char *next = p + 2;
+          int low = cook_unicode(&next, end);
+          if (low >= 0xdc00 && low < 0xe000) {
+            cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+            p = next;
+          }
+        }
+#endif
+        out = cook_emit(out, cp);
+        continue;
+      }
+    }
+
+    if (c >= '0' && c <= '7') {
+      // "\0" or legacy octal (invalid in templates and strict mode, but allow anyway)
+      int v = c - '0';
+      int max = (c <= '3') ? 2 : 1;
+      while (max-- && p < end && *p >= '0' && *p <= '7') {
+        v = (v << 3) | (*p++ - '0');
+      }
+      out = cook_emit(out, v);
+      continue;
+    }
+
+#ifdef BLEP_UTF16
+    if (c == 0x2028 || c == 0x2029) {
+      continue;  // line continuation
+    }
+#else
+    // line continuation on U+2028 or U+2029
+    if ((unsigned char) c == 0xe2 && end - p >= 2 && (unsigned char) p[0] == 0x80 &&
+        ((unsigned char) p[1] == 0xa8 || (unsigned char) p[1] == 0xa9)) {
+      p += 2;
+      continue;
+    }
+#endif
+
+    // anything else (including quotes) is itself
+    *out++ = c;
+  }
+
+  return out - start;
+}
+
+// cooks a string token or template part (without holes), excluding its quotes/delimiters
+int blep_cook_token(struct token *t, blep_char *out) {
+  blep_char *p = t->p;
+  int len = t->len;
+  if (t->type != TOKEN_STRING || len < 2) {
+    return ERROR__UNEXPECTED;
+  }
+
+  blep_char first = p[0];
+  blep_char last = p[len - 1];
+  int suffix = 1;
+
+  switch (first) {
+    case '\'':
+    case '"':
+      if (last != first) {
+        return ERROR__UNEXPECTED;
+      }
+      break;
+
+    case '`':
+    case '}':
+      if (last == '{' && len >= 3 && p[len - 2] == '$') {
+        suffix = 2;
+      } else if (last != '`') {
+        return ERROR__UNEXPECTED;
+      }
+      break;
+
+    default:
+      return ERROR__UNEXPECTED;
+  }
+
+  return blep_cook(p + 1, len - 1 - suffix, out);
+}
@@ -0,0 +1,9 @@
+#ifndef __BLEP_COOK_H
+#define __BLEP_COOK_H
+
+#include "token.h"
+
+int blep_cook(blep_char *, int, blep_char *);
+int blep_cook_token(struct token *, blep_char *);
+
+#endif//__BLEP_COOK_H
@@ -2,6 +2,17 @@
 #ifndef __BLEP_DEF_H
 #define __BLEP_DEF_H
 
+#include <stdint.h>
+
+
+// The core reads UTF-8 by default. Building with BLEP_UTF16 instead reads UTF-16 code units (e.g.,
+// a JS string written directly into memory), and all pointers, lengths and offsets are in units.
+#ifdef BLEP_UTF16
+typedef uint16_t blep_char;
+#else
+typedef char blep_char;
+#endif
+
 
 #define ERROR__UNEXPECTED -1
 #define ERROR__STACK      -2  // stack didn't balance
@@ -0,0 +1,393 @@
+#include <string.h>
+#include "define.h"
+#include "intern.h"
+#include "splice.h"
+#include "arena.h"
+#include "../tokens/lit.h"
+
+#ifdef EMSCRIPTEN
+#include <emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+// Replaces member chains (e.g., "process.env.NODE_ENV") with text, by watching tokens as they're
+// emitted and recording splices. Only chains rooted on a plain reference match, and the longest
+// complete key wins. Chains which are assigned to or updated are left alone. Keys are copied into
+// static storage and outlive any one parse.
+//
+// This includes targets of "for (... in" and of destructuring, e.g. "[process.env.X] = a". Whether
+// an array or object literal is a pattern is only known after it closes, so splices for chains
+// which are its elements are held, and dropped if it's followed by "=", "of" or "in".
+
+#define DEFINE_MAX        128   // keys
+#define DEFINE_SLOTS      256   // must be a power of two, at least double DEFINE_MAX
+#define DEFINE_UNITS      8192  // total key and value storage
+#define DEFINE_DEPTH      64    // brackets tracked for destructuring, deeper ones are never patterns
+#define DEFINE_TARGETS    64    // initial splices held for patterns, grown in the arena
+
+struct define_entry {
+  blep_char *key;
+  int key_len;
+  int root_len;     // units of the first segment of key
+  blep_char *value;
+  int value_len;
+  int next;         // next entry with the same root, plus one
+  int alive;        // step this entry last matched at
+};
+
+struct define_level {
+  int literal;      // array or object literal, so maybe a pattern
+  int for_head;     // opened directly inside "for (", so may be followed by "in"
+  int mark;         // targets held when opened
+};
+
+struct define_slot {
+  uint32_t hash;    // of root
+  int index;        // first entry with this root, plus one, so zeroed slots are empty
+};
+
+int blep_define_active;
+
+static struct define_slot define_slots[DEFINE_SLOTS];
+static struct define_entry define_entries[DEFINE_MAX];
+static int define_count;
+static blep_char define_units[DEFINE_UNITS];
+static int define_units_used;
+static int define_reserved;
+
+// state of the chain being matched
+static struct define_entry *define_chain;   // first entry for root, or NULL if not in a chain
+static blep_char *define_start;             // start of chain
+static blep_char *define_last;              // end of the last segment
+static int define_pos;                      // units of key matched
+static int define_step;
+static int define_expect_dot;
+static int define_prev_incdec;
+static int define_prev_element;             // previous token can precede an element, e.g. "[" or ","
+static int define_prev_for;
+static int define_prev_for_head;            // previous token was the "(" of a "for"
+static int define_target;                   // chain is an element of a literal
+static int define_for_target;               // chain is directly inside "for ("
+static struct define_entry *define_match;   // longest complete match so far
+static blep_char *define_match_end;
+
+// open brackets, and splices of chains which are targets if their literal is a pattern
+static struct define_level define_levels[DEFINE_DEPTH];
+static int define_depth;
+static struct define_level *define_closed;  // literal closed by the previous token
+static int *define_targets;
+static int define_target_count;
+static int define_target_cap;
+
+static inline int define_equal(blep_char *a, blep_char *b, int len) {
+  for (int i = 0; i < len; ++i) {
+    if (a[i] != b[i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// finds the slot for this root: either holding it, or empty where it should go
+static inline struct define_slot *define_find(blep_char *p, int len, uint32_t hash) {
+  int at = hash & (DEFINE_SLOTS - 1);
+  for (;;) {
+    struct define_slot *slot = &define_slots[at];
+    if (!slot->index) {
+      return slot;
+    }
+    struct define_entry *e = &define_entries[slot->index - 1];
+    if (slot->hash == hash && e->root_len == len && define_equal(e->key, p, len)) {
+      return slot;
+    }
+    at = (at + 1) & (DEFINE_SLOTS - 1);
+  }
+}
+
+// clears all keys
+EMSCRIPTEN_KEEPALIVE
+void blep_define_clear() {
+  memset(define_slots, 0, sizeof(define_slots));
+  define_count = 0;
+  define_units_used = 0;
+  define_reserved = 0;
+  blep_define_active = 0;
+  blep_define_reset();
+}
+
+// returns storage for the next key and value, written one after the other, or NULL if full
+EMSCRIPTEN_KEEPALIVE
+blep_char *blep_define_reserve(int len) {
+  if (len <= 0 || define_count == DEFINE_MAX || define_units_used + len > DEFINE_UNITS) {
+    return 0;
+  }
+  define_reserved = len;
+  return define_units + define_units_used;
+}
+
+// adds the key and value written to blep_define_reserve, replacing any previous value
+EMSCRIPTEN_KEEPALIVE
+int blep_define_add(int key_len, int value_len) {
+  if (key_len <= 0 || value_len < 0 || key_len + value_len != define_reserved) {
+    return ERROR__UNEXPECTED;
+  }
+  blep_char *key = define_units + define_units_used;
+  define_reserved = 0;
+
+  // segments must be non-empty
+  int root_len = -1;
+  for (int i = 0, last = -1; i <= key_len; ++i) {
+    if (i != key_len && key[i] != '.') {
+      continue;
+    } else if (i - last == 1) {
+      return ERROR__UNEXPECTED;
+    } else if (root_len == -1) {
+      root_len = i;
+    }
+    last = i;
+  }
+
+  uint32_t hash = blep_intern_hash(key, root_len);
+  struct define_slot *slot = define_find(key, root_len, hash);
+
+  for (int index = slot->index; index; ) {
+    struct define_entry *e = &define_entries[index - 1];
+    if (e->key_len == key_len && define_equal(e->key, key, key_len)) {
+      e->value = key + key_len;
+      e->value_len = value_len;
+      define_units_used += key_len + value_len;
+      return 0;
+    }
+    index = e->next;
+  }
+
+  struct define_entry *e = &define_entries[define_count++];
+  e->key = key;
+  e->key_len = key_len;
+  e->root_len = root_len;
+  e->value = key + key_len;
+  e->value_len = value_len;
+  e->alive = 0;
+  e->next = slot->index;
+  slot->hash = hash;
+  slot->index = define_count;
+  define_units_used += key_len + value_len;
+  blep_define_active = 1;
+  return 0;
+}
+
+// resets chain state, for a new parse
+void blep_define_reset() {
+  define_chain = 0;
+  define_match = 0;
+  define_prev_incdec = 0;
+  define_prev_element = 0;
+  define_prev_for = 0;
+  define_prev_for_head = 0;
+  define_depth = 0;
+  define_closed = 0;
+  define_targets = 0;
+  define_target_count = 0;
+  define_target_cap = 0;
+}
+
+// whether this token, directly after a chain, assigns to or updates it
+static inline int define_is_change(struct token *t) {
+  if (t->type != TOKEN_OP) {
+    return 0;
+  } else if (t->special == MISC_INCDEC) {
+    return 1;
+  }
+  blep_char *p = t->p;
+
+  switch (t->len) {
+    case 1:
+      return p[0] == '=';
+
+    case 2:
+      if (p[0] == 'o' && p[1] == 'f') {
+        return 1;  // for (x.y of ...)
+      } else if (p[0] == 'i' && p[1] == 'n') {
+        return define_for_target;  // for (x.y in ...), but not "x.y in z"
+      }
+      return p[1] == '=' && p[0] != '=' && p[0] != '!' && p[0] != '<' && p[0] != '>';
+
+    case 3:
+      return p[2] == '=' && p[1] != '=';
+
+    case 4:
+      return p[3] == '=';
+  }
+  return 0;
+}
+
+// holds the next splice, to drop if the literal it's inside is a pattern
+static int define_hold() {
+  if (define_target_count == define_target_cap) {
+    int cap = define_target_cap ? define_target_cap << 1 : DEFINE_TARGETS;
+    int *targets = blep_arena_alloc(cap * sizeof(int));
+    if (!targets) {
+      return ERROR__INTERNAL;
+    }
+    if (define_target_count) {
+      memcpy(targets, define_targets, define_target_count * sizeof(int));
+    }
+    define_targets = targets;
+    define_target_cap = cap;
+  }
+  define_targets[define_target_count++] = blep_splice_count();
+  return 0;
+}
+
+// ends the chain, before the token t
+static inline int define_end(struct token *t) {
+  struct define_entry *match = define_match;
+  define_chain = 0;
+  define_match = 0;
+
+  if (!match) {
+    return 0;
+  } else if (define_match_end == define_last) {
+    if (define_is_change(t)) {
+      return 0;
+    }
+    if (define_target && (t->type == TOKEN_CLOSE || (t->type == TOKEN_OP && t->special == MISC_COMMA))) {
+      int ret = define_hold();
+      if (ret) {
+        return ret;
+      }
+    }
+  }
+  return blep_splice_add(define_start, define_match_end - define_start, match->value, match->value_len);
+}
+
+// tracks brackets, and drops held splices if the literal just closed is a pattern
+static inline void define_bracket(struct token *t) {
+  if (define_closed) {
+    struct define_level *level = define_closed;
+    define_closed = 0;
+
+    if (t->type == TOKEN_OP && (t->special == MISC_EQUALS || t->special == LIT_OF ||
+        (t->special == LIT_IN && level->for_head))) {
+      for (int i = level->mark; i < define_target_count; ++i) {
+        blep_splice_drop(define_targets[i]);
+      }
+      define_target_count = level->mark;
+    } else if (t->type == TOKEN_COLON) {
+      define_target_count = level->mark;  // computed key, e.g. "{[x.y]: z}", which is never a target
+    }
+    if (!define_depth) {
+      define_target_count = 0;  // nothing outside can be a pattern
+    }
+  }
+
+  switch (t->type) {
+    case TOKEN_BRACE:
+    case TOKEN_ARRAY:
+    case TOKEN_PAREN:
+    case TOKEN_TERNARY:
+    case TOKEN_BLOCK:
+      if (define_depth < DEFINE_DEPTH) {
+        struct define_level *level = &define_levels[define_depth];
+        level->literal = (t->type == TOKEN_BRACE || t->type == TOKEN_ARRAY);
+        level->for_head = define_prev_for_head;
+        level->mark = define_target_count;
+      }
+      ++define_depth;
+      break;
+
+    case TOKEN_CLOSE:
+      if (define_depth && define_depth-- <= DEFINE_DEPTH && define_levels[define_depth].literal) {
+        define_closed = &define_levels[define_depth];
+      }
+      break;
+  }
+}
+
+// advances every live entry past a segment, returning how many are still live
+static inline int define_advance(blep_char *p, int len, int dot) {
+  int live = 0;
+  int prev = define_step++;
+
+  for (struct define_entry *e = define_chain; e; e = e->next ? &define_entries[e->next - 1] : 0) {
+    if (e->alive != prev || e->key_len < define_pos + dot + len) {
+      continue;
+    }
+    blep_char *k = e->key + define_pos;
+    if ((dot && *k++ != '.') || !define_equal(k, p, len)) {
+      continue;
+    }
+    e->alive = define_step;
+    ++live;
+
+    if (e->key_len == define_pos + dot + len) {
+      define_match = e;
+      define_match_end = p + len;
+    }
+  }
+
+  define_pos += dot + len;
+  define_last = p + len;
+  return live;
+}
+
+// processes an emitted token, possibly adding a splice
+int blep_define_token(struct token *t) {
+  define_bracket(t);
+
+  int prev_incdec = define_prev_incdec;
+  int prev_element = define_prev_element;
+  int prev_for_head = define_prev_for_head;
+  define_prev_incdec = (t->type == TOKEN_OP && t->special == MISC_INCDEC);
+  define_prev_element = (t->type == TOKEN_ARRAY || t->type == TOKEN_BRACE || t->type == TOKEN_COLON ||
+      (t->type == TOKEN_OP && (t->special == MISC_COMMA || t->special == MISC_SPREAD)));
+  define_prev_for_head = (define_prev_for && t->type == TOKEN_PAREN);
+  define_prev_for = (t->type == TOKEN_KEYWORD && t->special == LIT_FOR);
+
+  if (define_chain) {
+    if (define_expect_dot) {
+      if (t->type == TOKEN_OP && t->special == MISC_DOT) {
+        define_expect_dot = 0;
+        return 0;
+      }
+    } else if (t->type == TOKEN_LIT && (t->special & SPECIAL__PROPERTY)) {
+      define_expect_dot = 1;
+      if (!define_advance(t->p, t->len, 1)) {
+        return define_end(t);
+      }
+      return 0;
+    }
+
+    int ret = define_end(t);
+    if (ret) {
+      return ret;
+    }
+  }
+
+  // can this start a chain?
+  if (t->type != TOKEN_SYMBOL || prev_incdec ||
+      (t->special & (SPECIAL__PROPERTY | SPECIAL__CHANGE | SPECIAL__DECLARE | SPECIAL__EXTERNAL))) {
+    return 0;
+  }
+  struct define_slot *slot = define_find(t->p, t->len, blep_intern_hash(t->p, t->len));
+  if (!slot->index) {
+    return 0;
+  }
+
+  define_chain = &define_entries[slot->index - 1];
+  define_start = t->p;
+  define_pos = 0;
+  define_expect_dot = 1;
+  define_target = prev_element && define_depth && define_depth <= DEFINE_DEPTH &&
+      define_levels[define_depth - 1].literal;
+  define_for_target = prev_for_head;
+
+  // nb. all entries for this root are live, so mark them from the previous step
+  ++define_step;
+  for (struct define_entry *e = define_chain; e; e = e->next ? &define_entries[e->next - 1] : 0) {
+    e->alive = define_step;
+  }
+  define_advance(t->p, t->len, 0);
+  return 0;
+}
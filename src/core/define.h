@@ -0,0 +1,14 @@
+#ifndef __BLEP_DEFINE_H
+#define __BLEP_DEFINE_H
+
+#include "token.h"
+
+void blep_define_clear();
+blep_char *blep_define_reserve(int);
+int blep_define_add(int, int);
+void blep_define_reset();
+int blep_define_token(struct token *);
+
+extern int blep_define_active;
+
+#endif//__BLEP_DEFINE_H
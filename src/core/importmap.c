@@ -0,0 +1,330 @@
+#include "importmap.h"
+#include "arena.h"
+#include "splice.h"
+
+#ifdef EMSCRIPTEN
+#include <emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+// Applies an import map (https://github.com/WICG/import-maps) to import and export specifiers as
+// they're emitted, recording splices. Each scope has a trie of its keys: a key matches exactly, or
+// as a prefix if it ends with "/", and the longest key wins. Specifiers are matched as written
+// (i.e., not resolved as URLs), and those with escapes are left alone. The map is sized up front
+// and lives in one block, kept in the arena so it outlives any one parse.
+
+struct importmap_node {
+  int child;    // first child, or zero
+  int sibling;  // next sibling, or zero
+  int value;    // plus one, so zero has none
+  blep_char c;
+};
+
+struct importmap_value {
+  int at;           // in units
+  int len;
+  int suffix_len;   // directly after value
+};
+
+struct importmap_scope {
+  int root;
+  int at;           // prefix in units
+  int len;
+};
+
+// header of the block, followed by its nodes, values, scopes, order and units
+struct importmap {
+  int node_count, node_cap;
+  int value_count, value_cap;
+  int scope_count, scope_cap;  // including the top-level
+  int units_used, units_cap;   // values, suffixes and scope prefixes
+
+  // scopes for the current importer, most specific first and ending with the top-level
+  int order_count;
+};
+
+int blep_importmap_active;
+
+static struct importmap *importmap;  // moved by the arena
+static blep_char *importmap_reserved_at;
+static int importmap_reserved;
+
+// pointers into the block, valid until the next parse
+static struct importmap_node *importmap_nodes;
+static struct importmap_value *importmap_values;
+static struct importmap_scope *importmap_scopes;
+static int *importmap_order;
+static blep_char *importmap_units;
+
+static int importmap_layout(struct importmap *m) {
+  char *p = (char *) (m + 1);
+  importmap_nodes = (struct importmap_node *) p;
+  p += m->node_cap * sizeof(struct importmap_node);
+  importmap_values = (struct importmap_value *) p;
+  p += m->value_cap * sizeof(struct importmap_value);
+  importmap_scopes = (struct importmap_scope *) p;
+  p += m->scope_cap * sizeof(struct importmap_scope);
+  importmap_order = (int *) p;
+  p += m->scope_cap * sizeof(int);
+  importmap_units = (blep_char *) p;
+  p += m->units_cap * sizeof(blep_char);
+  return p - (char *) m;
+}
+
+// clears the map, so nothing is mapped
+EMSCRIPTEN_KEEPALIVE
+void blep_importmap_clear() {
+  importmap = 0;
+  importmap_reserved = 0;
+  blep_importmap_active = 0;
+  blep_arena_keep(0, 0);
+}
+
+// clears the map and sizes it for scopes (besides the top-level), entries, and units of keys and
+// of everything else (values, suffixes and scope prefixes), returning non-zero if it can't fit
+EMSCRIPTEN_KEEPALIVE
+int blep_importmap_size(int scopes, int entries, int key_units, int units) {
+  blep_importmap_clear();
+  if (scopes < 0 || entries < 0 || key_units < 0 || units < 0) {
+    return ERROR__INTERNAL;
+  }
+
+  struct importmap header = {
+    .node_count = 1,
+    .node_cap = 1 + scopes + key_units,  // every key unit could need a node
+    .value_cap = entries,
+    .scope_count = 1,
+    .scope_cap = 1 + scopes,
+    .units_cap = units,
+    .order_count = 1,
+  };
+  int size = importmap_layout(&header);
+  struct importmap *m = blep_arena_alloc(size);
+  if (!m) {
+    return ERROR__INTERNAL;
+  }
+  *m = header;
+  importmap_layout(m);
+
+  importmap_nodes[0].child = 0;
+  importmap_nodes[0].value = 0;
+  importmap_scopes[0].root = 0;
+  importmap_scopes[0].len = 0;
+  importmap_order[0] = 0;
+
+  importmap = m;
+  blep_arena_keep((void **) &importmap, size);
+  return 0;
+}
+
+// returns temporary storage for the next scope, entry or importer, or NULL if there's no space
+EMSCRIPTEN_KEEPALIVE
+blep_char *blep_importmap_reserve(int len) {
+  importmap_reserved_at = blep_arena_scratch(len * sizeof(blep_char));
+  importmap_reserved = importmap_reserved_at ? len : 0;
+  return importmap_reserved_at;
+}
+
+static inline int importmap_new_node(blep_char c) {
+  if (importmap->node_count == importmap->node_cap) {
+    return 0;
+  }
+  struct importmap_node *node = &importmap_nodes[importmap->node_count];
+  node->child = 0;
+  node->sibling = 0;
+  node->value = 0;
+  node->c = c;
+  return importmap->node_count++;
+}
+
+// copies len reserved units to the end of the block's units, returning where they start
+static int importmap_copy(blep_char *from, int len) {
+  int at = importmap->units_used;
+  for (int i = 0; i < len; ++i) {
+    importmap_units[at + i] = from[i];
+  }
+  importmap->units_used += len;
+  return at;
+}
+
+// starts a scope with the reserved prefix, which following entries are added to
+EMSCRIPTEN_KEEPALIVE
+int blep_importmap_scope(int len) {
+  if (!importmap || len != importmap_reserved || importmap->scope_count == importmap->scope_cap ||
+      importmap->units_used + len > importmap->units_cap) {
+    return ERROR__INTERNAL;
+  }
+  importmap_layout(importmap);
+  int root = importmap_new_node(0);
+  if (!root) {
+    return ERROR__INTERNAL;
+  }
+
+  struct importmap_scope *scope = &importmap_scopes[importmap->scope_count++];
+  scope->root = root;
+  scope->len = len;
+  scope->at = importmap_copy(importmap_reserved_at, len);
+  importmap_reserved = 0;
+  return 0;
+}
+
+// adds the reserved key, value and suffix (one after the other) to the last scope
+EMSCRIPTEN_KEEPALIVE
+int blep_importmap_add(int key_len, int value_len, int suffix_len) {
+  if (!importmap || key_len <= 0 || value_len < 0 || suffix_len < 0 ||
+      key_len + value_len + suffix_len != importmap_reserved ||
+      importmap->value_count == importmap->value_cap ||
+      importmap->units_used + value_len + suffix_len > importmap->units_cap) {
+    return ERROR__INTERNAL;
+  }
+  importmap_layout(importmap);
+  blep_char *key = importmap_reserved_at;
+  importmap_reserved = 0;
+
+  int at = importmap_scopes[importmap->scope_count - 1].root;
+  for (int i = 0; i < key_len; ++i) {
+    int child = importmap_nodes[at].child;
+    while (child && importmap_nodes[child].c != key[i]) {
+      child = importmap_nodes[child].sibling;
+    }
+    if (!child) {
+      child = importmap_new_node(key[i]);
+      if (!child) {
+        return ERROR__INTERNAL;
+      }
+      importmap_nodes[child].sibling = importmap_nodes[at].child;
+      importmap_nodes[at].child = child;
+    }
+    at = child;
+  }
+
+  struct importmap_value *value = &importmap_values[importmap->value_count++];
+  value->len = value_len;
+  value->suffix_len = suffix_len;
+  value->at = importmap_copy(key + key_len, value_len + suffix_len);
+  importmap_nodes[at].value = importmap->value_count;  // nb. replaces any previous value
+  blep_importmap_active = 1;
+  return 0;
+}
+
+// selects the scopes matching the reserved importer (its URL), for following parses
+EMSCRIPTEN_KEEPALIVE
+int blep_importmap_importer(int len) {
+  if (len != importmap_reserved) {
+    return ERROR__INTERNAL;
+  }
+  importmap_reserved = 0;
+  if (!importmap) {
+    return 0;
+  }
+  importmap_layout(importmap);
+  blep_char *importer = importmap_reserved_at;
+  int count = 0;
+
+  for (int i = 1; i < importmap->scope_count; ++i) {
+    struct importmap_scope *scope = &importmap_scopes[i];
+    if (scope->len > len) {
+      continue;
+    }
+    blep_char *prefix = importmap_units + scope->at;
+    int j = 0;
+    while (j < scope->len && prefix[j] == importer[j]) {
+      ++j;
+    }
+    if (j != scope->len) {
+      continue;
+    }
+
+    // insert, keeping the longest (most specific) prefixes first
+    int k = count++;
+    while (k && importmap_scopes[importmap_order[k - 1]].len < scope->len) {
+      importmap_order[k] = importmap_order[k - 1];
+      --k;
+    }
+    importmap_order[k] = i;
+  }
+
+  importmap_order[count++] = 0;
+  importmap->order_count = count;
+  return count;
+}
+
+// finds the value for a specifier in a scope, setting the length of specifier it matched
+static struct importmap_value *importmap_lookup(int root, blep_char *p, int len, int *matched) {
+  struct importmap_value *prefix = 0;
+  int at = root;
+
+  for (int i = 0; i < len; ++i) {
+    int child = importmap_nodes[at].child;
+    while (child && importmap_nodes[child].c != p[i]) {
+      child = importmap_nodes[child].sibling;
+    }
+    if (!child) {
+      return prefix;
+    }
+    at = child;
+
+    struct importmap_node *node = &importmap_nodes[at];
+    if (node->value && node->c == '/') {
+      prefix = &importmap_values[node->value - 1];
+      *matched = i + 1;
+    }
+  }
+
+  if (importmap_nodes[at].value) {
+    *matched = len;
+    return &importmap_values[importmap_nodes[at].value - 1];
+  }
+  return prefix;
+}
+
+// processes an emitted token, possibly adding a splice for a mapped specifier
+int blep_importmap_token(struct token *t) {
+  if (t->type != TOKEN_STRING || !(t->special & SPECIAL__EXTERNAL) || t->len < 2 || t->p[0] == '`') {
+    return 0;
+  }
+  if (!importmap) {
+    return ERROR__INTERNAL;  // the kept block didn't fit in this arena
+  }
+  importmap_layout(importmap);
+
+  blep_char *p = t->p + 1;
+  int len = t->len - 2;
+  for (int i = 0; i < len; ++i) {
+    if (p[i] == '\\') {
+      return 0;
+    }
+  }
+
+  struct importmap_value *value = 0;
+  int matched = 0;
+  for (int i = 0; i < importmap->order_count && !value; ++i) {
+    value = importmap_lookup(importmap_scopes[importmap_order[i]].root, p, len, &matched);
+  }
+  if (!value) {
+    return 0;
+  }
+
+  // build quote, value, rest of specifier, suffix, quote
+  int rest = len - matched;
+  int size = 2 + value->len + rest + value->suffix_len;
+  blep_char *out = blep_arena_alloc(size * sizeof(blep_char));
+  if (!out) {
+    return ERROR__INTERNAL;
+  }
+  blep_char *w = out;
+  *w++ = t->p[0];
+  for (int i = 0; i < value->len; ++i) {
+    *w++ = importmap_units[value->at + i];
+  }
+  for (int i = 0; i < rest; ++i) {
+    *w++ = p[matched + i];
+  }
+  for (int i = 0; i < value->suffix_len; ++i) {
+    *w++ = importmap_units[value->at + value->len + i];
+  }
+  *w++ = t->p[0];
+
+  return blep_splice_add(t->p, t->len, out, size);
+}
@@ -0,0 +1,16 @@
+#ifndef __BLEP_IMPORTMAP_H
+#define __BLEP_IMPORTMAP_H
+
+#include "token.h"
+
+void blep_importmap_clear();
+int blep_importmap_size(int, int, int, int);
+blep_char *blep_importmap_reserve(int);
+int blep_importmap_scope(int);
+int blep_importmap_add(int, int, int);
+int blep_importmap_importer(int);
+int blep_importmap_token(struct token *);
+
+extern int blep_importmap_active;
+
+#endif//__BLEP_IMPORTMAP_H
@@ -0,0 +1,125 @@
+#include <string.h>
+#include "intern.h"
+#include "arena.h"
+
+#ifdef EMSCRIPTEN
+#include <emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+// Assigns each distinct name a small ID, in the order they're first interned. Names are compared
+// by their raw source (so "a" and "\u0061" differ), and point into the input rather than being
+// copied. The table lives in the arena and is dropped on the next parse.
+
+#define INTERN_INITIAL    1024  // slots, must be a power of two
+#define INTERN_EMPTY      -1
+
+struct intern_slot {
+  uint32_t hash;
+  int id;
+};
+
+static struct intern_slot *intern_slots;
+static int intern_mask;
+static struct intern_name *intern_names;
+static int intern_count;
+
+EMSCRIPTEN_KEEPALIVE
+void blep_intern_reset() {
+  intern_slots = 0;
+  intern_names = 0;
+  intern_count = 0;
+}
+
+static inline int intern_equal(struct intern_name *name, blep_char *p, int len) {
+  if (name->len != len) {
+    return 0;
+  }
+  for (int i = 0; i < len; ++i) {
+    if (name->p[i] != p[i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// (re)allocates the table for size slots, keeping names at up to half load
+static int intern_resize(int size) {
+  struct intern_slot *slots = blep_arena_alloc(size * sizeof(struct intern_slot));
+  struct intern_name *names = blep_arena_alloc((size >> 1) * sizeof(struct intern_name));
+  if (!slots || !names) {
+    return ERROR__INTERNAL;
+  }
+  memset(slots, 0xff, size * sizeof(struct intern_slot));  // nb. sets id to INTERN_EMPTY
+  int mask = size - 1;
+
+  for (int i = 0; i <= intern_mask && intern_slots; ++i) {
+    struct intern_slot *prev = &intern_slots[i];
+    if (prev->id == INTERN_EMPTY) {
+      continue;
+    }
+    int at = prev->hash & mask;
+    while (slots[at].id != INTERN_EMPTY) {
+      at = (at + 1) & mask;
+    }
+    slots[at] = *prev;
+  }
+  if (intern_count) {
+    memcpy(names, intern_names, intern_count * sizeof(struct intern_name));
+  }
+
+  // nb. the old table is just abandoned in the arena
+  intern_slots = slots;
+  intern_names = names;
+  intern_mask = mask;
+  return 0;
+}
+
+// returns the ID of this name, adding it if unseen
+int blep_intern(blep_char *p, int len) {
+  if (!intern_slots || intern_count >= ((intern_mask + 1) >> 1)) {
+    int ret = intern_resize(intern_slots ? (intern_mask + 1) << 1 : INTERN_INITIAL);
+    if (ret) {
+      return ret;
+    }
+  }
+
+  uint32_t hash = blep_intern_hash(p, len);
+  int at = hash & intern_mask;
+  for (;;) {
+    struct intern_slot *slot = &intern_slots[at];
+    if (slot->id == INTERN_EMPTY) {
+      break;
+    } else if (slot->hash == hash && intern_equal(&intern_names[slot->id], p, len)) {
+      return slot->id;
+    }
+    at = (at + 1) & intern_mask;
+  }
+
+  int id = intern_count++;
+  intern_slots[at].hash = hash;
+  intern_slots[at].id = id;
+  intern_names[id].p = p;
+  intern_names[id].len = len;
+  return id;
+}
+
+// returns the ID for a name-like token, or -1 for other tokens
+int blep_intern_token(struct token *t) {
+  if (t->type != TOKEN_LIT && t->type != TOKEN_SYMBOL) {
+    return -1;
+  }
+  return blep_intern(t->p, t->len);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int blep_intern_count() {
+  return intern_count;
+}
+
+// returns names indexed by ID, valid until the next intern
+EMSCRIPTEN_KEEPALIVE
+struct intern_name *blep_intern_names() {
+  return intern_names;
+}
@@ -0,0 +1,26 @@
+#ifndef __BLEP_INTERN_H
+#define __BLEP_INTERN_H
+
+#include "token.h"
+
+struct intern_name {
+  blep_char *p;
+  int len;
+};
+
+// hashes a name (FNV-1a)
+static inline uint32_t blep_intern_hash(blep_char *p, int len) {
+  uint32_t h = 2166136261u;
+  for (int i = 0; i < len; ++i) {
+    h = (h ^ (uint16_t) p[i]) * 16777619u;
+  }
+  return h;
+}
+
+void blep_intern_reset();
+int blep_intern(blep_char *, int);
+int blep_intern_token(struct token *);
+int blep_intern_count();
+struct intern_name *blep_intern_names();
+
+#endif//__BLEP_INTERN_H
@@ -0,0 +1,168 @@
+#include <string.h>
+#include "minify.h"
+#include "arena.h"
+#include "../tokens/lit.h"
+
+#ifdef EMSCRIPTEN
+#include <emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+// Strips whitespace and comments by copying emitted tokens into an output buffer, dropping the
+// void (vp to p) before each. A single separator is kept where the void had one and it's needed:
+// a newline where ASI might depend on it, otherwise a space where tokens would merge. The output
+// is never longer than the input, and lives in the arena until the next parse.
+
+int blep_minify_active;
+
+static blep_char *minify_out;
+static blep_char *minify_at;
+
+// previous emitted token, zero if none
+static int minify_prev_type;
+static uint32_t minify_prev_special;
+static blep_char minify_prev_last;
+
+EMSCRIPTEN_KEEPALIVE
+void blep_minify_enable(int active) {
+  blep_minify_active = active;
+}
+
+// starts minifying this input, if enabled
+int blep_minify_reset(blep_char *p, int len) {
+  minify_prev_type = 0;
+  if (!blep_minify_active) {
+    minify_out = minify_at = 0;
+    return 0;
+  }
+
+  minify_out = blep_arena_alloc((len + 1) * sizeof(blep_char));
+  if (!minify_out) {
+    return ERROR__INTERNAL;
+  }
+  minify_at = minify_out;
+
+  // keep any "#!" line, which the parser treats as void
+  if (len >= 2 && p[0] == '#' && p[1] == '!') {
+    blep_char *end = blep_memchr(p, '\n', len);
+    int line = end ? (end - p) + 1 : len;
+    memcpy(minify_at, p, line * sizeof(blep_char));
+    minify_at += line;
+  }
+  return 0;
+}
+
+static inline int minify_ident(blep_char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+      c == '_' || c == '$' || c == '\\' || (c & ~0x7f);  // nb. blep_char may be signed
+}
+
+// could ASI end a statement after this token (e.g., "a", ")", "++", "yield")?
+static inline int minify_ends_statement(int type, uint32_t special, blep_char last) {
+  switch (type) {
+    case TOKEN_LIT:
+    case TOKEN_SYMBOL:
+    case TOKEN_KEYWORD:
+    case TOKEN_NUMBER:
+    case TOKEN_STRING:
+    case TOKEN_REGEXP:
+    case TOKEN_CLOSE:
+      return 1;
+
+    case TOKEN_OP:
+      return special == MISC_INCDEC || minify_ident(last);
+  }
+  return 0;
+}
+
+// could this token start a statement after ASI (e.g., "a", "(", "++", "typeof")?
+static inline int minify_starts_statement(struct token *t) {
+  switch (t->type) {
+    case TOKEN_LIT:
+    case TOKEN_SYMBOL:
+    case TOKEN_KEYWORD:
+    case TOKEN_LABEL:
+    case TOKEN_NUMBER:
+    case TOKEN_STRING:
+    case TOKEN_REGEXP:
+    case TOKEN_PAREN:
+    case TOKEN_ARRAY:
+    case TOKEN_BRACE:
+    case TOKEN_BLOCK:
+      return 1;
+
+    case TOKEN_OP: {
+      // unary operators, "typeof" etc, and "*" (for "yield\n*")
+      blep_char c = t->p[0];
+      return c == '+' || c == '-' || c == '!' || c == '~' || c == '*' || minify_ident(c);
+    }
+  }
+  return 0;
+}
+
+// returns the separator to keep between the previous token and this one, or zero
+static inline blep_char minify_separator(struct token *t) {
+  int void_len = t->p - t->vp;
+  if (!void_len || !minify_prev_type) {
+    return 0;
+  }
+
+  if (minify_ends_statement(minify_prev_type, minify_prev_special, minify_prev_last) &&
+      minify_starts_statement(t) &&
+      blep_memchr(t->vp, '\n', void_len)) {
+    return '\n';
+  }
+
+  blep_char last = minify_prev_last;
+  blep_char first = t->p[0];
+  if (minify_ident(first) && (minify_ident(last) || minify_prev_type == TOKEN_REGEXP)) {
+    return ' ';  // "a b", or "/re/ in x"
+  }
+
+  switch (last) {
+    case '+':
+    case '-':
+      // "a + +b", "a - -b", and "a-- > b" (which would start a "-->" comment)
+      return (first == last || (last == '-' && first == '>')) ? ' ' : 0;
+
+    case '/':
+      return (first == '/' || first == '*') ? ' ' : 0;  // don't start a comment
+
+    case '<':
+      return first == '!' ? ' ' : 0;  // "<!--" is a comment
+  }
+
+  if (minify_prev_type == TOKEN_NUMBER && first == '.') {
+    return ' ';  // "1 .toString()"
+  }
+  return 0;
+}
+
+// copies an emitted token to the output, after any separator it needs
+void blep_minify_token(struct token *t) {
+  if (!t->len || !minify_out) {
+    return;
+  }
+
+  blep_char sep = minify_separator(t);
+  if (sep) {
+    *minify_at++ = sep;
+  }
+  memcpy(minify_at, t->p, t->len * sizeof(blep_char));
+  minify_at += t->len;
+
+  minify_prev_type = t->type;
+  minify_prev_special = t->special;
+  minify_prev_last = t->p[t->len - 1];
+}
+
+EMSCRIPTEN_KEEPALIVE
+blep_char *blep_minify_output() {
+  return minify_out;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int blep_minify_length() {
+  return minify_at - minify_out;
+}
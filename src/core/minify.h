@@ -0,0 +1,14 @@
+#ifndef __BLEP_MINIFY_H
+#define __BLEP_MINIFY_H
+
+#include "token.h"
+
+void blep_minify_enable(int);
+int blep_minify_reset(blep_char *, int);
+void blep_minify_token(struct token *);
+blep_char *blep_minify_output();
+int blep_minify_length();
+
+extern int blep_minify_active;
+
+#endif//__BLEP_MINIFY_H
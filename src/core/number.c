@@ -0,0 +1,237 @@
+#include <stdint.h>
+#include "number.h"
+
+// Decodes numeric literals into their value. Decimals take Clinger's fast path, which is exact (so
+// correctly rounded) whenever the digits and the power of ten are both exactly representable,
+// which covers almost all literals found in source. Other decimals are passed to the host, whose
+// conversion is also correctly rounded. Hex, octal and binary are always rounded here.
+
+#ifdef EMSCRIPTEN
+double blep_number_slow(blep_char *, int);  // must be provided, e.g. Number() in JS
+#else
+#include <stdlib.h>
+
+static double blep_number_slow(blep_char *p, int len) {
+  char buf[len + 1];
+  int out = 0;
+  for (int i = 0; i < len; ++i) {
+    if (p[i] != '_') {
+      buf[out++] = (char) p[i];
+    }
+  }
+  buf[out] = 0;
+
+  return strtod(buf, NULL);
+}
+#endif
+
+#define NUMBER_NAN        (__builtin_nan(""))
+#define MANTISSA_DIGITS   19      // decimal digits which always fit in uint64_t
+#define EXACT_MANTISSA    (1ULL << 53)
+#define EXACT_POW10       22
+#define TWO_POW64         18446744073709551616.0
+
+static const double number_pow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// decodes a hex, octal or binary literal (after its prefix)
+static inline double number_radix(blep_char *p, blep_char *end, int bits) {
+  uint64_t v = 0;
+  int digits = 0;
+  int dropped = 0;  // bits past the 64 kept in v
+  int sticky = 0;   // any of those were set
+  int max = (1 << bits);
+
+  for (; p < end; ++p) {
+    blep_char c = *p;
+    int d;
+    if (c == '_') {
+      continue;
+    } else if (c >= '0' && c <= '9') {
+      d = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      d = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      d = c - 'A' + 10;
+    } else {
+      return NUMBER_NAN;
+    }
+    if (d >= max) {
+      return NUMBER_NAN;
+    }
+    ++digits;
+
+    if (v >> (64 - bits)) {
+      dropped += bits;
+      sticky |= d;
+    } else {
+      v = (v << bits) | d;
+    }
+  }
+
+  if (!digits) {
+    return NUMBER_NAN;
+  }
+
+  // v holds at least 61 significant bits once any are dropped, so its lowest bit is well below the
+  // rounding bit of a double and can stand in for the dropped ones
+  double out = (double) (v | (sticky != 0));  // conversion from 64-bit is correctly rounded
+  for (; dropped >= 64 && out < __builtin_inf(); dropped -= 64) {
+    out *= TWO_POW64;
+  }
+  return dropped < 64 ? out * (double) (1ULL << dropped) : out;
+}
+
+// decodes a decimal literal
+static inline double number_decimal(blep_char *p, blep_char *end) {
+  blep_char *start = p;
+  uint64_t mantissa = 0;
+  int digits = 0;     // significant digits in mantissa
+  int exp10 = 0;
+  int seen = 0;       // any digits at all
+  int truncated = 0;  // non-zero digits didn't fit in mantissa
+
+  // integer part
+  for (; p < end; ++p) {
+    blep_char c = *p;
+    if (c == '_') {
+      continue;
+    } else if (c < '0' || c > '9') {
+      break;
+    }
+    seen = 1;
+    if (digits < MANTISSA_DIGITS) {
+      mantissa = mantissa * 10 + (c - '0');
+      digits += (mantissa != 0);
+    } else {
+      ++exp10;
+      truncated |= (c != '0');
+    }
+  }
+
+  // fraction
+  if (p < end && *p == '.') {
+    for (++p; p < end; ++p) {
+      blep_char c = *p;
+      if (c == '_') {
+        continue;
+      } else if (c < '0' || c > '9') {
+        break;
+      }
+      seen = 1;
+      if (digits < MANTISSA_DIGITS) {
+        mantissa = mantissa * 10 + (c - '0');
+        digits += (mantissa != 0);
+        --exp10;
+      } else {
+        truncated |= (c != '0');
+      }
+    }
+  }
+  if (!seen) {
+    return NUMBER_NAN;
+  }
+
+  // exponent
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    int negative = 0;
+    if (p < end && (*p == '+' || *p == '-')) {
+      negative = (*p == '-');
+      ++p;
+    }
+
+    int e = 0;
+    int exp_digits = 0;
+    for (; p < end; ++p) {
+      blep_char c = *p;
+      if (c == '_') {
+        continue;
+      } else if (c < '0' || c > '9') {
+        break;
+      }
+      if (e < 100000) {
+        e = e * 10 + (c - '0');
+      }
+      ++exp_digits;
+    }
+    if (!exp_digits) {
+      return NUMBER_NAN;
+    }
+    exp10 += negative ? -e : e;
+  }
+
+  if (p != end) {
+    return NUMBER_NAN;
+  } else if (mantissa == 0 && !truncated) {
+    return 0;
+  }
+
+  if (!truncated && mantissa <= EXACT_MANTISSA) {
+    double m = (double) mantissa;
+    if (exp10 >= 0 && exp10 <= EXACT_POW10) {
+      return m * number_pow10[exp10];
+    } else if (exp10 < 0 && exp10 >= -EXACT_POW10) {
+      return m / number_pow10[-exp10];
+    } else if (exp10 > EXACT_POW10 && exp10 <= EXACT_POW10 + 15) {
+      // e.g. 123e25: move some of the power into the mantissa, if it stays exact
+      double shifted = m * number_pow10[exp10 - EXACT_POW10];
+      if (shifted <= (double) EXACT_MANTISSA) {
+        return shifted * number_pow10[EXACT_POW10];
+      }
+    }
+  }
+
+  return blep_number_slow(start, end - start);
+}
+
+// decodes a numeric literal, setting NUMBER__BIGINT in flags if it has a "n" suffix (nb. the
+// returned value is then only an approximation), or returning NaN if invalid
+double blep_number(blep_char *p, int len, int *flags) {
+  blep_char *end = p + len;
+  *flags = 0;
+
+  if (len && end[-1] == 'n') {
+    *flags |= NUMBER__BIGINT;
+    --end;
+  }
+
+  if (end - p >= 2 && p[0] == '0') {
+    switch (p[1]) {
+      case 'x':
+      case 'X':
+        return number_radix(p + 2, end, 4);
+
+      case 'o':
+      case 'O':
+        return number_radix(p + 2, end, 3);
+
+      case 'b':
+      case 'B':
+        return number_radix(p + 2, end, 1);
+    }
+  }
+
+  // legacy octal (e.g., "0777", invalid in strict mode) unless it has an 8 or 9, e.g. "089"
+  if (end - p >= 2 && p[0] == '0' && p[1] >= '0' && p[1] <= '9') {
+    blep_char *q = p + 1;
+    while (q < end && *q >= '0' && *q <= '7') {
+      ++q;
+    }
+    if (q == end) {
+      return number_radix(p + 1, end, 3);
+    }
+  }
+
+  return number_decimal(p, end);
+}
+
+double blep_number_token(struct token *t, int *flags) {
+  if (t->type != TOKEN_NUMBER) {
+    *flags = 0;
+    return NUMBER_NAN;
+  }
+  return blep_number(t->p, t->len, flags);
+}
@@ -0,0 +1,11 @@
+#ifndef __BLEP_NUMBER_H
+#define __BLEP_NUMBER_H
+
+#include "token.h"
+
+#define NUMBER__BIGINT    1   // has "n" suffix
+
+double blep_number(blep_char *, int, int *);
+double blep_number_token(struct token *, int *);
+
+#endif//__BLEP_NUMBER_H
@@ -2,6 +2,17 @@
 #include "parser.h"
 #include "../tokens/lit.h"
 #include "token.h"
+#include "cook.h"
+#include "number.h"
+#include "intern.h"
+#include "watch.h"
+#include "splice.h"
+#include "define.h"
+#include "importmap.h"
+#include "minify.h"
+#include "sourcemap.h"
+#include "stats.h"
+#include "profile.h"
 #include <string.h>
 
 #ifdef EMSCRIPTEN
@@ -43,16 +54,51 @@ static int consume_destructuring(int);
 
 
 static int parser_skip = 0;
+static int parser_lookahead = 0;  // also counted in parser_skip
+static int parser_error = 0;  // deferred from cursor_next, whose result is rarely checked
 
 
 #define cursor (&(td->curr))
 #define peek (&(td->peek))
 
 
-// emit cursor and continue
+#ifdef BLEP_VALIDATE
+
+// When validating (see validate.c), there are no hooks: tokens and stacks are just consumed.
+
+#define cursor_next blep_token_next
+
+#define _STACK_BEGIN(type) {
+#define _STACK_END() ; }
+
+#else
+
+// emit cursor (if not skipped or filtered by the watchlist) and continue; the C hooks see every
+// token once, even in stacks skipped by blep_parser_open, as they rewrite the whole source
 static inline int cursor_next() {
+  if (!parser_lookahead) {
+    if (blep_minify_active) {
+      blep_minify_token(cursor);
+    }
+    if (blep_sourcemap_active) {
+      int ret = blep_sourcemap_token(cursor);
+      parser_error = parser_error ? parser_error : ret;
+    }
+    if (blep_define_active) {
+      int ret = blep_define_token(cursor);
+      parser_error = parser_error ? parser_error : ret;
+    }
+    if (blep_importmap_active) {
+      int ret = blep_importmap_token(cursor);
+      parser_error = parser_error ? parser_error : ret;
+    }
+  }
   if (!parser_skip) {
-    blep_parser_callback();
+    _stat(++blep_stats.tokens[cursor->type]);
+    if (!blep_watch_active || blep_watch_match(cursor) >= 0) {
+      _stat(++blep_stats.callbacks);
+      blep_parser_callback();
+    }
   }
   return blep_token_next();
 }
@@ -61,6 +107,7 @@ static inline int cursor_next() {
 #define _STACK_BEGIN(type) { \
   const int _stack_type = type; \
   int _prev_parser_skip = parser_skip; \
+  _stat(blep_stats.stacks[_stack_type] += !parser_skip); \
   parser_skip = parser_skip || blep_parser_open(type);
 
 // ends an optional stack
@@ -69,6 +116,8 @@ static inline int cursor_next() {
   parser_skip = _prev_parser_skip; \
 }
 
+#endif
+
 // ends an optional stack _and_ consumes an upcoming semicolon on same line
 #define _STACK_END_SEMICOLON() \
     if (cursor->type == TOKEN_SEMICOLON && cursor->special == 0) { \
@@ -79,10 +128,12 @@ static inline int cursor_next() {
 #define _SET_RESTORE() \
   if (!parser_skip) { \
     ++parser_skip; \
+    ++parser_lookahead; \
     blep_token_set_restore();
 
 #define _RESUME_RESTORE() \
     --parser_skip; \
+    --parser_lookahead; \
     blep_token_restore(); \
   }
 
@@ -90,6 +141,7 @@ static inline int cursor_next() {
 
 // consume a single string (permissively allow ``)
 inline static int consume_basic_key_string_special(int special) {
+  _profile(consume_basic_key_string_special);
   if (cursor->type != TOKEN_STRING || (cursor->p[0] == '`' && cursor->len > 1 && cursor->p[cursor->len - 1] != '`')) {
     // can't have templated string here at all, but allow single
     return ERROR__UNEXPECTED;
@@ -101,6 +153,7 @@ inline static int consume_basic_key_string_special(int special) {
 
 // consume a name of a function/class etc, needed as sometimes it's _just_ a name, not a decl
 inline static int consume_defn_name(int special) {
+  _profile(consume_defn_name);
   if (cursor->special == LIT_EXTENDS || cursor->type != TOKEN_LIT) {
 #ifdef DEBUG
     if (peek->p) {
@@ -135,6 +188,7 @@ inline static int consume_defn_name(int special) {
 }
 
 static inline int consume_dict() {
+  _profile(consume_dict);
 #ifdef DEBUG
   if (cursor->type != TOKEN_BRACE) {
     debugf("missing open brace for dict");
@@ -295,6 +349,7 @@ static inline int consume_dict() {
 // consume zero or many expressions (which can also be blank), separated by commas
 // may consume literally nothing
 static int consume_expr_zero_many(int is_statement) {
+  _profile(consume_expr_zero_many);
   for (;;) {
     _check(consume_expr_internal(is_statement));
     if (cursor->special != MISC_COMMA) {
@@ -308,6 +363,7 @@ static int consume_expr_zero_many(int is_statement) {
 
 // consumes a boring grouped expr (paren, array, ternary)
 static int consume_expr_group() {
+  _profile(consume_expr_group);
   int open = cursor->type;
 #ifdef DEBUG
   switch (cursor->type) {
@@ -334,6 +390,7 @@ static int consume_expr_group() {
 
 // consume arrowfunc from and including "=>"
 static int consume_arrowfunc_from_arrow(int is_statement) {
+  _profile(consume_arrowfunc_from_arrow);
   if (cursor->special != MISC_ARROW) {
     debugf("arrowfunc missing =>");
     return ERROR__UNEXPECTED;
@@ -349,6 +406,7 @@ static int consume_arrowfunc_from_arrow(int is_statement) {
 
 // we assume that we're pointing at one (is_arrowfunc has returned true)
 static int consume_arrowfunc(int is_statement) {
+  _profile(consume_arrowfunc);
   // "async" prefix without immediate =>
   int is_async = (cursor->special == LIT_ASYNC && !(blep_token_peek() == TOKEN_OP && peek->special == MISC_ARROW));
   if (is_async) {
@@ -386,6 +444,7 @@ static int consume_arrowfunc(int is_statement) {
 }
 
 static int consume_template_string() {
+  _profile(consume_template_string);
 #ifdef DEBUG
   if (cursor->type != TOKEN_STRING || cursor->p[0] != '`') {
     debugf("bad templated string");
@@ -394,7 +453,7 @@ static int consume_template_string() {
 #endif
 
   for (;;) {
-    char end = cursor->p[cursor->len - 1];
+    blep_char end = cursor->p[cursor->len - 1];
     cursor_next();
 
     if (end == '`') {
@@ -417,6 +476,7 @@ static int consume_template_string() {
 }
 
 static int maybe_consume_destructuring() {
+  _profile(maybe_consume_destructuring);
   switch (cursor->type) {
     case TOKEN_ARRAY:
     case TOKEN_BRACE:
@@ -443,6 +503,7 @@ static int maybe_consume_destructuring() {
 
 // does lookahead to check for `async () =>` or `() =>`
 static int lookahead_is_paren_arrowfunc() {
+  _profile(lookahead_is_paren_arrowfunc);
   if (cursor->special == LIT_ASYNC) {
     cursor_next();
   }
@@ -469,6 +530,7 @@ static int lookahead_is_paren_arrowfunc() {
 }
 
 static int maybe_consume_arrowfunc(int is_statement) {
+  _profile(maybe_consume_arrowfunc);
   // short-circuits
   if (cursor->type == TOKEN_LIT) {
     blep_token_peek();
@@ -519,12 +581,13 @@ static int is_token_assign_like(struct token *t) {
 
 // like the other, but counts ()'s
 static int consume_expr_internal(int is_statement) {
+  _profile(consume_expr_internal);
   int paren_count = 0;
 
 restart_expr:
   (void)sizeof(0);
   int value_line = 0;
-  char *start = cursor->p;
+  blep_char *start = cursor->p;
 
   // lookahead #1: check for arrowfunc at this position
   _check(maybe_consume_arrowfunc(is_statement));
@@ -851,7 +914,8 @@ restart_expr:
 }
 
 static inline int consume_expr(int is_statement) {
-  char *start = cursor->p;
+  _profile(consume_expr);
+  blep_char *start = cursor->p;
   _check(consume_expr_internal(is_statement));
 
   if (start == cursor->p) {
@@ -864,6 +928,7 @@ static inline int consume_expr(int is_statement) {
 // consume destructuring: this is not always __DECLARE, because it could be in an expr
 // special will contain SPECIAL__TOP or SPECIAL__DECLARE
 static int consume_destructuring(int special) {
+  _profile(consume_destructuring);
 #ifdef DEBUG
   int special_mask = (SPECIAL__TOP | SPECIAL__DECLARE);
   if ((special | special_mask) != special_mask) {
@@ -970,6 +1035,7 @@ static int consume_destructuring(int special) {
 
 // consumes a single definition (e.g. `catch (x)` or x in `function(x, y) {}`
 static int consume_optional_definition(int special, int is_statement) {
+  _profile(consume_optional_definition);
   int is_spread = 0;
   int is_assign = 0;
 
@@ -1015,6 +1081,7 @@ static int consume_optional_definition(int special, int is_statement) {
 
 // consumes an optional "= <expr>"
 static int consume_optional_assign_suffix(int is_statement) {
+  _profile(consume_optional_assign_suffix);
   if (cursor->special == MISC_EQUALS) {
     cursor_next();
     _STACK_BEGIN(STACK__EXPR);
@@ -1026,6 +1093,7 @@ static int consume_optional_assign_suffix(int is_statement) {
 
 // consumes a number of comma-separated definitions (does not create stack)
 static int consume_definition_list(int special, int is_statement) {
+  _profile(consume_definition_list);
   for (;;) {
     _check(consume_optional_definition(special, is_statement));
     _check(consume_optional_assign_suffix(is_statement));
@@ -1039,6 +1107,7 @@ static int consume_definition_list(int special, int is_statement) {
 // wraps consume_definition_list (comma-separated list) by looking for parens
 // used in functions (normal, class, arrow)
 static int consume_definition_group() {
+  _profile(consume_definition_group);
   if (cursor->type != TOKEN_PAREN) {
     debugf("definition didn't start with paren, was type=%d special=%d", cursor->type, cursor->special);
     return ERROR__UNEXPECTED;
@@ -1058,6 +1127,7 @@ static int consume_definition_group() {
 }
 
 static int consume_function(int special) {
+  _profile(consume_function);
   cursor->type = TOKEN_KEYWORD;
 
   // nb. this is either a top-level declaration or within an expr
@@ -1096,6 +1166,7 @@ static int consume_function(int special) {
 }
 
 static int consume_class(int special) {
+  _profile(consume_class);
 #ifdef DEBUG
   if (cursor->special != LIT_CLASS) {
     debugf("expected class keyword");
@@ -1128,6 +1199,7 @@ static int consume_class(int special) {
 }
 
 static int consume_decl_stack(int special) {
+  _profile(consume_decl_stack);
 #ifdef DEBUG
   if (!(cursor->special & _MASK_DECL)) {
     debugf("expected decl start");
@@ -1145,6 +1217,7 @@ static int consume_decl_stack(int special) {
 
 
 static int consume_module_list_deep(int mode) {
+  _profile(consume_module_list_deep);
 #ifdef DEBUG
   if (cursor->type != TOKEN_BRACE) {
     debugf("expected { to start module deep");
@@ -1245,6 +1318,7 @@ static int consume_module_list_deep(int mode) {
 
 // consumes comma-separated part after `import` keyword
 static int consume_import_module_list() {
+  _profile(consume_import_module_list);
   for (;;) {
     // check for inner brace
     if (cursor->type == TOKEN_BRACE) {
@@ -1305,6 +1379,7 @@ static int consume_import_module_list() {
 }
 
 static int consume_import() {
+  _profile(consume_import);
 #ifdef DEBUG
   if (cursor->special != LIT_IMPORT) {
     debugf("missing import keyword");
@@ -1332,6 +1407,7 @@ static int consume_import() {
 
 // consumes only a reexport (must be on `export` keyword)
 static int consume_export_reexport() {
+  _profile(consume_export_reexport);
 #ifdef DEBUG
   if (cursor->special != LIT_EXPORT) {
     debugf("missing export keyword");
@@ -1383,6 +1459,7 @@ static int consume_export_reexport() {
 
 // consumes a declare export (must be on `export` keyword) from self
 static int consume_export_declare() {
+  _profile(consume_export_declare);
 #ifdef DEBUG
   if (cursor->special != LIT_EXPORT) {
     debugf("missing export keyword");
@@ -1430,6 +1507,7 @@ static int consume_export_declare() {
 
 // consumes a regular export or a reexport, generating stack information
 static int consume_export_wrap() {
+  _profile(consume_export_wrap);
 #ifdef DEBUG
   if (cursor->special != LIT_EXPORT) {
     debugf("missing export keyword");
@@ -1474,6 +1552,7 @@ static int consume_export_wrap() {
 }
 
 static inline int consume_control_group_inner(int control_hash) {
+  _profile(consume_control_group_inner);
   switch (control_hash) {
     case LIT_CATCH:
       // special-case catch, which creates a local scoped var
@@ -1504,7 +1583,7 @@ static inline int consume_control_group_inner(int control_hash) {
       cursor->type = TOKEN_KEYWORD;
       cursor_next();
 
-      char *start = cursor->p;
+      blep_char *start = cursor->p;
       _check(consume_optional_definition(special, 0));
       if (start == cursor->p) {
         debugf("expected var def after decl");
@@ -1574,6 +1653,7 @@ static inline int consume_control_group_inner(int control_hash) {
 }
 
 static int consume_control() {
+  _profile(consume_control);
 #ifdef DEBUG
   if (!(cursor->special & _MASK_CONTROL)) {
     debugf("expected _MASK_CONTROL for consume_control");
@@ -1615,7 +1695,7 @@ static int consume_control() {
     // we awkwardly peer into the parser to see if we _just_ consumed a semicolon
     // this allows us to to parse `do 1 \n ; while (0)`, which is totally valid
     // (although ; isn't attached to the prior stack)
-    char prev = cursor->vp[-1];
+    blep_char prev = cursor->vp[-1];
     if (prev != ';' && cursor->type == TOKEN_SEMICOLON) {
       cursor_next();
     }
@@ -1650,9 +1730,10 @@ static int consume_control() {
 }
 
 static int consume_expr_statement() {
+  _profile(consume_expr_statement);
   _STACK_BEGIN(STACK__EXPR);
 
-  char *start = cursor->p;
+  blep_char *start = cursor->p;
   _check(consume_expr_zero_many(1));
   if (start == cursor->p) {
     debugf("could not consume any expr statement, token=%d %.*s", cursor->type, cursor->len, cursor->p);
@@ -1664,6 +1745,7 @@ static int consume_expr_statement() {
 }
 
 static int consume_statement(int mode) {
+  _profile(consume_statement);
   switch (cursor->type) {
     case TOKEN_EOF:
     case TOKEN_COLON:
@@ -1869,13 +1951,17 @@ static int consume_statement(int mode) {
   return consume_expr_statement();
 }
 
-EMSCRIPTEN_KEEPALIVE
-int blep_parser_init(char *p, int len) {
+// starts the tokenizer and parser state over this input
+static int parser_begin(blep_char *p, int len) {
   _check(blep_token_init(p, len));
+  _stat(blep_stats_reset());
+  _profile_reset();
   parser_skip = 0;
+  parser_lookahead = 0;
+  parser_error = 0;
 
   if (p[0] == '#' && p[1] == '!') {
-    td->at = memchr(p, '\n', td->end - p);
+    td->at = blep_memchr(p, '\n', td->end - p);
     if (td->at == NULL) {
       td->at = p + len;
     }
@@ -1887,14 +1973,48 @@ int blep_parser_init(char *p, int len) {
   return 0;
 }
 
+#ifdef BLEP_VALIDATE
+
+// parses the entire input without hooks, returning zero if valid or an error
+EMSCRIPTEN_KEEPALIVE
+int blep_validate(blep_char *p, int len) {
+  _check(parser_begin(p, len));
+
+  while (cursor->type != TOKEN_EOF) {
+    blep_char *head = cursor->p;
+    _check(consume_statement(STATEMENT__TOP));
+    if (cursor->p == head && cursor->type != TOKEN_EOF) {
+      debugf("blep_validate consumed nothing, token=%d", cursor->type);
+      return ERROR__UNEXPECTED;
+    }
+  }
+  return 0;
+}
+
+#else
+
+EMSCRIPTEN_KEEPALIVE
+int blep_parser_init(blep_char *p, int len) {
+  blep_intern_reset();
+  blep_splice_reset();
+  blep_define_reset();
+  _check(blep_minify_reset(p, len));
+  blep_sourcemap_reset();
+  return parser_begin(p, len);
+}
+
 EMSCRIPTEN_KEEPALIVE
 int blep_parser_run() {
   if (cursor->type == TOKEN_EOF) {
+    if (blep_define_active) {
+      _check(blep_define_token(cursor));  // ends any chain at the end of input
+    }
     return 0;
   }
-  char *head = cursor->p;
+  blep_char *head = cursor->p;
 
   _check(consume_statement(STATEMENT__TOP));
+  _check(parser_error);
 
   int len = cursor->p - head;
   if (len == 0 && cursor->type != TOKEN_EOF) {
@@ -1908,3 +2028,36 @@ EMSCRIPTEN_KEEPALIVE
 struct token *blep_parser_cursor() {
   return cursor;
 }
+
+EMSCRIPTEN_KEEPALIVE
+int blep_parser_cursor_column() {
+  return blep_token_column(cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int blep_parser_cursor_utf16() {
+  return blep_token_utf16(cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int blep_parser_cursor_cook(blep_char *out) {
+  return blep_cook_token(cursor, out);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int blep_parser_cursor_id() {
+  return blep_intern_token(cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int blep_parser_cursor_watch() {
+  return blep_watch_match(cursor);
+}
+
+EMSCRIPTEN_KEEPALIVE
+double blep_parser_cursor_number() {
+  int flags;
+  return blep_number_token(cursor, &flags);
+}
+
+#endif
@@ -5,10 +5,15 @@
 #include "token.h"
 #include "def.h"
 
-int blep_parser_init(char *, int);
+int blep_parser_init(blep_char *, int);
 int blep_parser_run();
 struct token *blep_parser_cursor();
 
+// parses without any hooks below, returning zero if valid (see validate.c); this shares the token
+// state (td) with blep_parser_run, so it clobbers any parse in progress and must not be called from
+// the hooks below, and afterwards the cursor is wherever validation stopped (e.g., at an error)
+int blep_validate(blep_char *, int);
+
 // below must be provided
 
 void blep_parser_callback();
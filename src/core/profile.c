@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 199309L  // clock_gettime
+
+#include "profile.h"
+
+#ifdef BLEP_PROFILE
+
+#ifdef EMSCRIPTEN
+#include <emscripten.h>
+double blep_profile_now();  // must be provided, e.g. performance.now() in JS
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#include <stdlib.h>
+#include <time.h>
+
+static double blep_profile_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+#endif
+
+struct profile_frame {
+  int function;
+  int node;
+  double start;
+  double children;  // inclusive time of direct callees
+};
+
+static const char *profile_names[] = {
+#define _profile_name(name) #name,
+  BLEP_PROFILE_FUNCTIONS(_profile_name)
+#undef _profile_name
+};
+
+static struct profile_function profile_functions[PROFILE__COUNT];
+static struct profile_node profile_nodes[PROFILE_NODES];
+static int profile_node_count;
+static struct profile_frame profile_frames[PROFILE_DEPTH];
+static int profile_depth;
+
+void blep_profile_reset() {
+  for (int i = 0; i < PROFILE__COUNT; ++i) {
+    profile_functions[i] = (struct profile_function) {0};
+  }
+
+  // node zero is the root, with no function
+  profile_nodes[0] = (struct profile_node) {.parent = -1, .function = -1, .child = -1, .sibling = -1};
+  profile_node_count = 1;
+  profile_depth = 0;
+}
+
+// finds or adds the child of this node for a function, or returns the node itself if full
+static int profile_child(int node, int function) {
+  int at = profile_nodes[node].child;
+  while (at >= 0) {
+    if (profile_nodes[at].function == function) {
+      return at;
+    }
+    at = profile_nodes[at].sibling;
+  }
+
+  if (profile_node_count == PROFILE_NODES) {
+    return node;
+  }
+  at = profile_node_count++;
+  profile_nodes[at] = (struct profile_node) {
+    .parent = node,
+    .function = function,
+    .child = -1,
+    .sibling = profile_nodes[node].child,
+  };
+  profile_nodes[node].child = at;
+  return at;
+}
+
+int blep_profile_enter(int function) {
+  int frame = profile_depth++;
+  if (frame >= PROFILE_DEPTH) {
+    return frame;
+  }
+
+  struct profile_function *f = &profile_functions[function];
+  ++f->calls;
+  ++f->active;
+
+  int parent = frame ? profile_frames[frame - 1].node : 0;
+  profile_frames[frame] = (struct profile_frame) {
+    .function = function,
+    .node = profile_child(parent, function),
+    .start = blep_profile_now(),
+  };
+  return frame;
+}
+
+void blep_profile_exit(int *frame_at) {
+  int frame = *frame_at;
+  --profile_depth;
+  if (frame >= PROFILE_DEPTH) {
+    return;
+  }
+
+  struct profile_frame *p = &profile_frames[frame];
+  double elapsed = blep_profile_now() - p->start;
+  double self = elapsed - p->children;
+
+  struct profile_function *f = &profile_functions[p->function];
+  f->exclusive += self;
+  if (--f->active == 0) {
+    f->inclusive += elapsed;
+  }
+  profile_nodes[p->node].self += self;
+
+  if (frame) {
+    profile_frames[frame - 1].children += elapsed;
+  }
+}
+
+EMSCRIPTEN_KEEPALIVE
+int blep_profile_count() {
+  return PROFILE__COUNT;
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char *blep_profile_name(int function) {
+  return profile_names[function];
+}
+
+EMSCRIPTEN_KEEPALIVE
+struct profile_function *blep_profile_functions() {
+  return profile_functions;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int blep_profile_node_count() {
+  return profile_node_count;
+}
+
+EMSCRIPTEN_KEEPALIVE
+struct profile_node *blep_profile_nodes() {
+  return profile_nodes;
+}
+
+#ifndef EMSCRIPTEN
+
+static int profile_compare(const void *a, const void *b) {
+  double ea = profile_functions[*(const int *) a].exclusive;
+  double eb = profile_functions[*(const int *) b].exclusive;
+  return (ea < eb) - (ea > eb);
+}
+
+// prints called functions by exclusive time
+void blep_profile_report(FILE *out) {
+  int order[PROFILE__COUNT];
+  double total = 0;
+  for (int i = 0; i < PROFILE__COUNT; ++i) {
+    order[i] = i;
+    total += profile_functions[i].exclusive;
+  }
+  qsort(order, PROFILE__COUNT, sizeof(int), profile_compare);
+
+  fprintf(out, "%-36s %10s %12s %12s %7s\n", "function", "calls", "incl (ms)", "excl (ms)", "excl %");
+  for (int i = 0; i < PROFILE__COUNT; ++i) {
+    struct profile_function *f = &profile_functions[order[i]];
+    if (!f->calls) {
+      continue;
+    }
+    fprintf(out, "%-36s %10d %12.3f %12.3f %6.1f%%\n", profile_names[order[i]], f->calls,
+        f->inclusive, f->exclusive, total ? 100 * f->exclusive / total : 0);
+  }
+}
+
+// prints folded stacks (e.g., for flamegraph.pl) of exclusive time, in microseconds
+void blep_profile_folded(FILE *out) {
+  int path[PROFILE_DEPTH];
+
+  for (int i = 1; i < profile_node_count; ++i) {
+    long us = (long) (profile_nodes[i].self * 1e3);
+    if (us <= 0) {
+      continue;
+    }
+
+    int depth = 0;
+    for (int at = i; at > 0 && depth < PROFILE_DEPTH; at = profile_nodes[at].parent) {
+      path[depth++] = at;
+    }
+    while (depth--) {
+      fprintf(out, "%s%c", profile_names[profile_nodes[path[depth]].function], depth ? ';' : ' ');
+    }
+    fprintf(out, "%ld\n", us);
+  }
+}
+
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef __BLEP_PROFILE_H
+#define __BLEP_PROFILE_H
+
+// Per-function timing, when built with -DBLEP_PROFILE. Profiled functions start with
+// _profile(name), which times them until they return. Otherwise, this compiles to nothing.
+
+#define BLEP_PROFILE_FUNCTIONS(_) \
+  _(consume_statement) \
+  _(consume_expr_statement) \
+  _(consume_expr) \
+  _(consume_expr_internal) \
+  _(consume_expr_zero_many) \
+  _(consume_expr_group) \
+  _(consume_dict) \
+  _(consume_basic_key_string_special) \
+  _(consume_defn_name) \
+  _(consume_template_string) \
+  _(maybe_consume_arrowfunc) \
+  _(lookahead_is_paren_arrowfunc) \
+  _(consume_arrowfunc) \
+  _(consume_arrowfunc_from_arrow) \
+  _(maybe_consume_destructuring) \
+  _(consume_destructuring) \
+  _(consume_optional_definition) \
+  _(consume_optional_assign_suffix) \
+  _(consume_definition_list) \
+  _(consume_definition_group) \
+  _(consume_function) \
+  _(consume_class) \
+  _(consume_decl_stack) \
+  _(consume_module_list_deep) \
+  _(consume_import_module_list) \
+  _(consume_import) \
+  _(consume_export_reexport) \
+  _(consume_export_declare) \
+  _(consume_export_wrap) \
+  _(consume_control_group_inner) \
+  _(consume_control) \
+  _(blepi_consume_token) \
+  _(blepi_consume_void) \
+  _(blepi_consume_slash_regexp) \
+  _(blepi_maybe_consume_alnum_group) \
+  _(blepi_consume_basic_string) \
+  _(blepi_consume_template) \
+  _(blepi_consume_number)
+
+#ifdef BLEP_PROFILE
+
+enum {
+#define _profile_enum(name) PROFILE__##name,
+  BLEP_PROFILE_FUNCTIONS(_profile_enum)
+#undef _profile_enum
+  PROFILE__COUNT
+};
+
+#define PROFILE_NODES 4096  // distinct call paths, further paths are merged into their parent
+#define PROFILE_DEPTH 4096  // calls deeper than this aren't timed
+
+// times are in ms
+struct profile_function {
+  double inclusive;  // recursive calls aren't counted twice
+  double exclusive;
+  int calls;
+  int active;
+};
+
+// a node in the tree of call paths, for folded stacks
+struct profile_node {
+  double self;
+  int parent;
+  int function;
+  int child;
+  int sibling;
+};
+
+int blep_profile_enter(int);
+void blep_profile_exit(int *);
+void blep_profile_reset();
+
+#ifndef EMSCRIPTEN
+#include <stdio.h>
+void blep_profile_report(FILE *);
+void blep_profile_folded(FILE *);
+#endif
+
+#define _profile(name) \
+  int _profile_frame __attribute__((cleanup(blep_profile_exit))) = blep_profile_enter(PROFILE__##name)
+#define _profile_reset() blep_profile_reset()
+
+#else
+
+#define _profile(name)
+#define _profile_reset()
+
+#endif
+
+#endif//__BLEP_PROFILE_H
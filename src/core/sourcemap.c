@@ -0,0 +1,225 @@
+#include <string.h>
+#include "sourcemap.h"
+#include "splice.h"
+#include "minify.h"
+#include "arena.h"
+
+#ifdef EMSCRIPTEN
+#include <emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+// Records where each emitted token came from, then encodes the "mappings" of a source map (Base64
+// VLQ) in one pass over the output: either the input with splices applied (as assembled), or the
+// minified output. Tokens inside a replaced range map from the start of the replacement. Lines are
+// split on '\n' like the tokenizer, and columns are in UTF-16 units. The marks and the mappings
+// live in the arena until the next parse.
+
+#define SOURCEMAP_INITIAL   1024
+#define SOURCEMAP_SEGMENT   (1 + 4 * 7)  // ',' and four 32-bit values
+
+int blep_sourcemap_active;
+
+static struct sourcemap_mark *sourcemap_marks;
+static int sourcemap_count;
+static int sourcemap_cap;
+static int sourcemap_minified;
+
+static char *sourcemap_out;
+static char *sourcemap_at;
+static char *sourcemap_end;
+
+// generated column, and the previous segment (fields are relative to it)
+static int sourcemap_column;
+static int sourcemap_first;
+static int sourcemap_prev_column;
+static int sourcemap_prev_src_line;
+static int sourcemap_prev_src_column;
+
+static const char sourcemap_base64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+EMSCRIPTEN_KEEPALIVE
+void blep_sourcemap_enable(int active) {
+  blep_sourcemap_active = active;
+}
+
+void blep_sourcemap_reset() {
+  sourcemap_marks = 0;
+  sourcemap_count = 0;
+  sourcemap_cap = 0;
+  sourcemap_out = 0;
+  sourcemap_minified = blep_minify_active;
+}
+
+// records an emitted token (after the minifier has copied it, if active)
+int blep_sourcemap_token(struct token *t) {
+  if (!t->len) {
+    return 0;
+  }
+  if (sourcemap_count == sourcemap_cap) {
+    int cap = sourcemap_cap ? sourcemap_cap << 1 : SOURCEMAP_INITIAL;
+    struct sourcemap_mark *marks = blep_arena_alloc(cap * sizeof(struct sourcemap_mark));
+    if (!marks) {
+      return ERROR__INTERNAL;
+    }
+    if (sourcemap_count) {
+      memcpy(marks, sourcemap_marks, sourcemap_count * sizeof(struct sourcemap_mark));
+    }
+    sourcemap_marks = marks;
+    sourcemap_cap = cap;
+  }
+
+  struct sourcemap_mark *m = &sourcemap_marks[sourcemap_count++];
+  m->p = t->p;
+  m->out = sourcemap_minified ? blep_minify_output() + blep_minify_length() - t->len : 0;
+  m->line = t->line_no - 1;
+  m->column = blep_token_column(t);
+  return 0;
+}
+
+// ensures size more bytes of mappings can be written
+static int sourcemap_reserve(int size) {
+  if (sourcemap_end - sourcemap_at >= size) {
+    return 1;
+  }
+  int used = sourcemap_at - sourcemap_out;
+  int cap = (sourcemap_end - sourcemap_out) * 2 + size;
+  char *out = blep_arena_alloc(cap);
+  if (!out) {
+    return 0;
+  }
+  if (used) {
+    memcpy(out, sourcemap_out, used);
+  }
+  sourcemap_out = out;
+  sourcemap_at = out + used;
+  sourcemap_end = out + cap;
+  return 1;
+}
+
+static inline void sourcemap_vlq(int value) {
+  uint32_t v = value < 0 ? ((uint32_t) -value << 1) | 1 : (uint32_t) value << 1;
+  do {
+    int digit = v & 31;
+    v >>= 5;
+    *sourcemap_at++ = sourcemap_base64[v ? digit | 32 : digit];
+  } while (v);
+}
+
+// moves the generated position over output text, ending the line of segments at each '\n'
+static int sourcemap_advance(blep_char *p, blep_char *end) {
+  for (; p < end; ++p) {
+#ifdef BLEP_UTF16
+    blep_char c = *p;
+#else
+    unsigned char c = *p;
+#endif
+    if (c == '\n') {
+      if (!sourcemap_reserve(1)) {
+        return 0;
+      }
+      *sourcemap_at++ = ';';
+      sourcemap_column = 0;
+      sourcemap_prev_column = 0;
+      sourcemap_first = 1;
+      continue;
+    }
+#ifndef BLEP_UTF16
+    if ((c & 0xc0) == 0x80) {
+      continue;  // continuation byte
+    } else if (c >= 0xf0) {
+      sourcemap_column += 2;  // outside the BMP, so a surrogate pair
+      continue;
+    }
+#endif
+    ++sourcemap_column;
+  }
+  return 1;
+}
+
+// writes a segment mapping the generated position to this mark
+static int sourcemap_segment(struct sourcemap_mark *m) {
+  if (!sourcemap_reserve(SOURCEMAP_SEGMENT)) {
+    return 0;
+  }
+  if (!sourcemap_first) {
+    *sourcemap_at++ = ',';
+  }
+  sourcemap_first = 0;
+
+  sourcemap_vlq(sourcemap_column - sourcemap_prev_column);
+  sourcemap_vlq(0);  // always the only source
+  sourcemap_vlq(m->line - sourcemap_prev_src_line);
+  sourcemap_vlq(m->column - sourcemap_prev_src_column);
+
+  sourcemap_prev_column = sourcemap_column;
+  sourcemap_prev_src_line = m->line;
+  sourcemap_prev_src_column = m->column;
+  return 1;
+}
+
+#define _sourcemap(x) if (!(x)) { return ERROR__INTERNAL; }
+
+// builds mappings for the output of the last parse of len units at p, returning their length
+EMSCRIPTEN_KEEPALIVE
+int blep_sourcemap_build(blep_char *p, int len) {
+  sourcemap_out = sourcemap_at = sourcemap_end = 0;
+  sourcemap_column = 0;
+  sourcemap_first = 1;
+  sourcemap_prev_column = 0;
+  sourcemap_prev_src_line = 0;
+  sourcemap_prev_src_column = 0;
+  _sourcemap(sourcemap_reserve(sourcemap_count * 8 + SOURCEMAP_SEGMENT));
+
+  struct sourcemap_mark *m = sourcemap_marks;
+  struct sourcemap_mark *m_end = m + sourcemap_count;
+
+  if (sourcemap_minified) {
+    blep_char *at = blep_minify_output();
+    for (; m < m_end; ++m) {
+      _sourcemap(sourcemap_advance(at, m->out) && sourcemap_segment(m));
+      at = m->out;
+    }
+    return sourcemap_at - sourcemap_out;
+  }
+
+  // walk splices as blep_splice_assemble does, dropping any that overlap
+  blep_char *end = p + len;
+  blep_char *at = p;
+  struct splice *s = blep_splice_list();
+  struct splice *s_end = s + blep_splice_count();
+  for (; s < s_end; ++s) {
+    if (s->p < at || s->p + s->len > end) {
+      continue;
+    }
+    for (; m < m_end && m->p < s->p; ++m) {
+      _sourcemap(sourcemap_advance(at, m->p) && sourcemap_segment(m));
+      at = m->p;
+    }
+    _sourcemap(sourcemap_advance(at, s->p));
+
+    blep_char *replaced = s->p + s->len;
+    if (m < m_end && m->p < replaced && s->text_len) {
+      _sourcemap(sourcemap_segment(m));
+    }
+    while (m < m_end && m->p < replaced) {
+      ++m;
+    }
+    _sourcemap(sourcemap_advance(s->text, s->text + s->text_len));
+    at = replaced;
+  }
+  for (; m < m_end; ++m) {
+    _sourcemap(sourcemap_advance(at, m->p) && sourcemap_segment(m));
+    at = m->p;
+  }
+
+  return sourcemap_at - sourcemap_out;
+}
+
+// returns the last built mappings (not NULL-terminated)
+EMSCRIPTEN_KEEPALIVE
+char *blep_sourcemap_output() {
+  return sourcemap_out;
+}
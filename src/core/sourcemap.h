@@ -0,0 +1,21 @@
+#ifndef __BLEP_SOURCEMAP_H
+#define __BLEP_SOURCEMAP_H
+
+#include "token.h"
+
+struct sourcemap_mark {
+  blep_char *p;    // token in input
+  blep_char *out;  // token in minified output, or NULL
+  int line;        // zero-based
+  int column;      // in UTF-16 units
+};
+
+void blep_sourcemap_enable(int);
+void blep_sourcemap_reset();
+int blep_sourcemap_token(struct token *);
+int blep_sourcemap_build(blep_char *, int);
+char *blep_sourcemap_output();
+
+extern int blep_sourcemap_active;
+
+#endif//__BLEP_SOURCEMAP_H
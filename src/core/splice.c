@@ -0,0 +1,154 @@
+#include <string.h>
+#include "splice.h"
+#include "arena.h"
+
+#ifdef EMSCRIPTEN
+#include <emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+// Records replacements of input ranges, which should be added in input order, and assembles the
+// output with them applied. A splice starting before the end of the previous one overlaps it and
+// is dropped: e.g., a define covering a token the host already replaced. The list and output live
+// in the arena and are dropped on the next parse.
+
+#define SPLICE_INITIAL    256
+
+static struct splice *splice_list;
+static int splice_count;
+static int splice_cap;
+static blep_char *splice_output;
+
+EMSCRIPTEN_KEEPALIVE
+void blep_splice_reset() {
+  splice_list = 0;
+  splice_count = 0;
+  splice_cap = 0;
+  splice_output = 0;
+}
+
+// adds a splice, replacing len units at p with text
+EMSCRIPTEN_KEEPALIVE
+int blep_splice_add(blep_char *p, int len, blep_char *text, int text_len) {
+  if (splice_count == splice_cap) {
+    int cap = splice_cap ? splice_cap << 1 : SPLICE_INITIAL;
+    struct splice *list = blep_arena_alloc(cap * sizeof(struct splice));
+    if (!list) {
+      return ERROR__INTERNAL;
+    }
+    if (splice_count) {
+      memcpy(list, splice_list, splice_count * sizeof(struct splice));
+    }
+    splice_list = list;
+    splice_cap = cap;
+  }
+
+  struct splice *s = &splice_list[splice_count++];
+  s->p = p;
+  s->len = len;
+  s->text = text;
+  s->text_len = text_len;
+  return 0;
+}
+
+// drops the splice at index, which stays in the list (so later indexes are stable) but does nothing
+void blep_splice_drop(int index) {
+  if (index >= 0 && index < splice_count) {
+    splice_list[index].len = 0;
+    splice_list[index].text_len = 0;
+  }
+}
+
+EMSCRIPTEN_KEEPALIVE
+int blep_splice_count() {
+  return splice_count;
+}
+
+// returns all splices, valid until the next add
+EMSCRIPTEN_KEEPALIVE
+struct splice *blep_splice_list() {
+  return splice_list;
+}
+
+// assembles len units of input at p with all splices applied, returning the output length
+EMSCRIPTEN_KEEPALIVE
+int blep_splice_assemble(blep_char *p, int len) {
+  blep_char *end = p + len;
+
+  // find the output size first, so it's one contiguous allocation
+  int size = len;
+  blep_char *at = p;
+  for (int i = 0; i < splice_count; ++i) {
+    struct splice *s = &splice_list[i];
+    if (s->p < at || s->p + s->len > end) {
+      continue;
+    }
+    size += s->text_len - s->len;
+    at = s->p + s->len;
+  }
+
+  blep_char *out = blep_arena_alloc(size * sizeof(blep_char));
+  if (!out) {
+    return ERROR__INTERNAL;
+  }
+  splice_output = out;
+
+  at = p;
+  for (int i = 0; i < splice_count; ++i) {
+    struct splice *s = &splice_list[i];
+    if (s->p < at || s->p + s->len > end) {
+      continue;
+    }
+    memcpy(out, at, (s->p - at) * sizeof(blep_char));
+    out += s->p - at;
+    memcpy(out, s->text, s->text_len * sizeof(blep_char));
+    out += s->text_len;
+    at = s->p + s->len;
+  }
+  memcpy(out, at, (end - at) * sizeof(blep_char));
+
+  return size;
+}
+
+// returns the last assembled output, or segments
+EMSCRIPTEN_KEEPALIVE
+blep_char *blep_splice_output() {
+  return splice_output;
+}
+
+// lists the output as segments of input and replacements without copying any text, for gathered
+// writes, returning the number of segments (each a pointer and length) at blep_splice_output
+EMSCRIPTEN_KEEPALIVE
+int blep_splice_segments(blep_char *p, int len) {
+  blep_char *end = p + len;
+  struct splice_segment *out = blep_arena_alloc((splice_count * 2 + 1) * sizeof(struct splice_segment));
+  if (!out) {
+    return ERROR__INTERNAL;
+  }
+  splice_output = (blep_char *) out;
+
+  int count = 0;
+  blep_char *at = p;
+  for (int i = 0; i < splice_count; ++i) {
+    struct splice *s = &splice_list[i];
+    if (s->p < at || s->p + s->len > end || (!s->len && !s->text_len)) {
+      continue;
+    }
+    if (s->p != at) {
+      out[count].p = at;
+      out[count++].len = s->p - at;
+    }
+    if (s->text_len) {
+      out[count].p = s->text;
+      out[count++].len = s->text_len;
+    }
+    at = s->p + s->len;
+  }
+  if (at != end) {
+    out[count].p = at;
+    out[count++].len = end - at;
+  }
+
+  return count;
+}
@@ -0,0 +1,27 @@
+#ifndef __BLEP_SPLICE_H
+#define __BLEP_SPLICE_H
+
+#include "token.h"
+
+struct splice {
+  blep_char *p;     // start of replaced input
+  int len;          // units of input replaced
+  blep_char *text;  // replacement (not copied)
+  int text_len;
+};
+
+struct splice_segment {
+  blep_char *p;
+  int len;
+};
+
+void blep_splice_reset();
+int blep_splice_add(blep_char *, int, blep_char *, int);
+void blep_splice_drop(int);
+int blep_splice_count();
+struct splice *blep_splice_list();
+int blep_splice_assemble(blep_char *, int);
+blep_char *blep_splice_output();
+int blep_splice_segments(blep_char *, int);
+
+#endif//__BLEP_SPLICE_H
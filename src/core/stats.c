@@ -0,0 +1,24 @@
+#include "stats.h"
+
+#ifdef BLEP_STATS
+
+#include <string.h>
+
+#ifdef EMSCRIPTEN
+#include <emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+struct blep_stats blep_stats;
+
+void blep_stats_reset() {
+  memset(&blep_stats, 0, sizeof(blep_stats));
+}
+
+EMSCRIPTEN_KEEPALIVE
+struct blep_stats *blep_stats_get() {
+  return &blep_stats;
+}
+
+#endif
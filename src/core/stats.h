@@ -0,0 +1,35 @@
+#ifndef __BLEP_STATS_H
+#define __BLEP_STATS_H
+
+#include "def.h"
+
+// Counters collected during a run, when built with -DBLEP_STATS. Otherwise, _stat() compiles to
+// nothing and this struct doesn't exist.
+
+#ifdef BLEP_STATS
+
+struct blep_stats {
+  int tokens[_TOKEN_MAX + 1];  // emitted (i.e., not skipped) by type
+  int stacks[_STACK_MAX + 1];  // opened by type
+  int max_depth;               // of td->depth
+  int peeks;                   // calls to blep_token_peek
+  int restores;                // restore points taken
+  int relexed;                 // units lexed again after a restore
+  int regexp_flips;            // tokens changed by blep_token_update
+  int callbacks;               // calls to blep_parser_callback
+};
+
+extern struct blep_stats blep_stats;
+
+void blep_stats_reset();
+struct blep_stats *blep_stats_get();
+
+#define _stat(x) (x)
+
+#else
+
+#define _stat(x)
+
+#endif
+
+#endif//__BLEP_STATS_H
@@ -16,6 +16,13 @@
 #define _LOOKUP__NUMBER    46
 #define _LOOKUP__SEMICOLON 47
 
+// look up a unit in a table below: UTF-16 units past Latin-1 are treated like high UTF-8 bytes
+#ifdef BLEP_UTF16
+#define _lookup(table, c) (table[(c) < 256 ? (c) : 128])
+#else
+#define _lookup(table, c) (table[(unsigned char) (c)])
+#endif
+
 static char lookup_symbol[256] = {
 // 0-127
   0, 0, 0, 0, 0, 0, 0, 0,
@@ -3,6 +3,8 @@
 #include <strings.h>
 #include <ctype.h>
 #include "token.h"
+#include "stats.h"
+#include "profile.h"
 
 #include "../tokens/helper.c"
 
@@ -16,6 +18,14 @@ tokendef _td;
 #define NULL ((char*)0)
 #endif
 
+#ifdef BLEP_UTF16
+#define _isdigit(c) ((c) < 128 && isdigit(c))
+#define _isalnum(c) ((c) < 128 && isalnum(c))
+#else
+#define _isdigit isdigit
+#define _isalnum isalnum
+#endif
+
 #ifdef DEBUG
 #include <stdio.h>
 #define debugf(...) fprintf(stderr, "!!! " __VA_ARGS__); fprintf(stderr, "\n")
@@ -24,13 +34,16 @@ tokendef _td;
 #endif
 
 
-int blep_token_init(char *p, int len) {
+int blep_token_init(blep_char *p, int len) {
   bzero(td, sizeof(tokendef));
 
   td->at = p;
+  td->start = p;
   td->end = p + len;
   td->line_no = 1;
+  td->line_at = p;
   td->depth = 1;
+  td->utf16__at = p;
 
   // sanity-check td->end is NULL
   if (len < 0 || td->end[0]) {
@@ -42,14 +55,15 @@ int blep_token_init(char *p, int len) {
 }
 
 // consume regexp "/foobar/"
-static inline int blepi_consume_slash_regexp(char *p) {
+static inline int blepi_consume_slash_regexp(blep_char *p) {
+  _profile(blepi_consume_slash_regexp);
 #ifdef DEBUG
   if (p[0] != '/') {
     debugf("failed to consume slash_regexp, no slash");
     return 0;
   }
 #endif
-  char *start = p;
+  blep_char *start = p;
   int is_charexpr = 0;
 
   while (++p < td->end) {
@@ -63,7 +77,7 @@ static inline int blepi_consume_slash_regexp(char *p) {
         // eat trailing flags
         do {
           ++p;
-        } while (isalnum(*p));
+        } while (_isalnum(*p));
         return p - start;
 
       case '\n':
@@ -88,32 +102,34 @@ static inline int blepi_consume_slash_regexp(char *p) {
   return p - start;
 }
 
-static inline int blepi_maybe_consume_alnum_group(char *p) {
+static inline int blepi_maybe_consume_alnum_group(blep_char *p) {
+  _profile(blepi_maybe_consume_alnum_group);
   if (p[0] != '{') {
     return 0;
   }
 
   int len = 1;
   for (;;) {
-    char c = p[len];
+    blep_char c = p[len];
     ++len;
 
     if (c == '}') {
       return len;
-    } else if (!isalnum(c)) {
+    } else if (!_isalnum(c)) {
       return ERROR__UNEXPECTED;
     }
   }
 }
 
-static inline int blepi_consume_basic_string(char *p, int *line_no) {
+static inline int blepi_consume_basic_string(blep_char *p, int *line_no) {
+  _profile(blepi_consume_basic_string);
 #ifdef DEBUG
   if (p[0] != '\'' && p[0] != '"') {
     debugf("got bad string starter");
     return 0;
   }
 #endif
-  char *start = p;
+  blep_char *start = p;
 
   for (;;) {
     ++p;
@@ -127,6 +143,7 @@ static inline int blepi_consume_basic_string(char *p, int *line_no) {
       case '\n':
         // nb. not valid here
         ++(*line_no);
+        td->line_at = p + 1;
         continue;
 
       case '\\':
@@ -146,7 +163,8 @@ static inline int blepi_consume_basic_string(char *p, int *line_no) {
   }
 }
 
-static inline int blepi_consume_template(char *p, int *line_no) {
+static inline int blepi_consume_template(blep_char *p, int *line_no) {
+  _profile(blepi_consume_template);
   // p[0] will be ` or }
 #ifdef DEBUG
   if (p[0] != '`' && p[0] != '}') {
@@ -154,7 +172,7 @@ static inline int blepi_consume_template(char *p, int *line_no) {
     return 0;
   }
 #endif
-  char *start = p;
+  blep_char *start = p;
 
   for (;;) {
     ++p;
@@ -167,6 +185,7 @@ static inline int blepi_consume_template(char *p, int *line_no) {
 
       case '\n':
         ++(*line_no);
+        td->line_at = p + 1;
         continue;
 
       case '\\':
@@ -188,9 +207,10 @@ static inline int blepi_consume_template(char *p, int *line_no) {
 }
 
 // consumes spaces/comments between tokens
-static inline int blepi_consume_void(char *p, int *line_no) {
+static inline int blepi_consume_void(blep_char *p, int *line_no) {
+  _profile(blepi_consume_void);
   int line_no_delta = 0;
-  char *start = p;
+  blep_char *start = p;
 
   for (;;) {
     switch (*p) {
@@ -205,12 +225,13 @@ static inline int blepi_consume_void(char *p, int *line_no) {
       case '\n':   // 10
         ++p;
         ++line_no_delta;
+        td->line_at = p;
         continue;
 
       case '/': {  // 47
-        char next = p[1];
+        blep_char next = p[1];
         if (next == '/') {
-          p = memchr(p, '\n', td->end - p);
+          p = blep_memchr(p, '\n', td->end - p);
           if (p == 0) {
             p = td->end;
           }
@@ -223,7 +244,7 @@ static inline int blepi_consume_void(char *p, int *line_no) {
         // nb. this can't use memchr because it's looking for both * and \n
         p += 2;
         do {
-          char c = *p;
+          blep_char c = *p;
           if (c == '*') {
             if (p[1] == '/') {
               p += 2;
@@ -231,6 +252,7 @@ static inline int blepi_consume_void(char *p, int *line_no) {
             }
           } else if (c == '\n') {
             ++line_no_delta;
+            td->line_at = p + 1;
           }
         } while (++p < td->end);
         continue;
@@ -245,17 +267,18 @@ static inline int blepi_consume_void(char *p, int *line_no) {
 }
 
 // consumes number, assumes first char is valid (dot or digit)
-static inline int blepi_consume_number(char *p) {
+static inline int blepi_consume_number(blep_char *p) {
+  _profile(blepi_consume_number);
 #ifdef DEBUG
-  if (!(isdigit(p[0]) || (p[0] == '.' && isdigit(p[1])))) {
+  if (!(_isdigit(p[0]) || (p[0] == '.' && _isdigit(p[1])))) {
     debugf("consume_number got bad digit");
     return 0;
   }
 #endif
   int len = 1;
-  char c = p[1];
+  blep_char c = p[1];
   for (;;) {
-    if (!(isalnum(c) || c == '.' || c == '_')) {  // letters, dots, etc- misuse is invalid, so eat anyway
+    if (!(_isalnum(c) || c == '.' || c == '_')) {  // letters, dots, etc- misuse is invalid, so eat anyway
       break;
     }
     c = p[++len];
@@ -263,7 +286,8 @@ static inline int blepi_consume_number(char *p) {
   return len;
 }
 
-static inline void blepi_consume_token(struct token *t, char *p, int *line_no) {
+static inline void blepi_consume_token(struct token *t, blep_char *p, int *line_no) {
+  _profile(blepi_consume_token);
 #define _ret(_len, _type) {t->special = 0; t->type = _type; t->len = _len; return;};
 #define _reth(_len, _type, _hash) {t->special = _hash; t->type = _type; t->len = _len; return;};
 #define _inc_stack(_type) { \
@@ -275,11 +299,12 @@ static inline void blepi_consume_token(struct token *t, char *p, int *line_no) {
         debugf("hit stack upper limit"); \
         _ret(0, TOKEN_EOF); \
       } \
+      _stat(blep_stats.max_depth = td->depth > blep_stats.max_depth ? td->depth : blep_stats.max_depth); \
     }
 
   struct token *prev = &(td->curr);
-  const unsigned char initial = p[0];
-  int op = lookup_op[initial];
+  const blep_char initial = p[0];
+  int op = _lookup(lookup_op, initial);
   int len = 0;
 
   switch (op) {
@@ -288,7 +313,7 @@ static inline void blepi_consume_token(struct token *t, char *p, int *line_no) {
     case _LOOKUP__OP_3: {
       op &= 3;  // remove 32 bit, just use 1,2 bits
       len = 1;
-      char c = p[len];
+      blep_char c = p[len];
       while (len < op && c == initial) {
         c = p[++len];
       }
@@ -337,7 +362,7 @@ static inline void blepi_consume_token(struct token *t, char *p, int *line_no) {
     }
 
     case _LOOKUP__DOT:
-      if (isdigit(p[1])) {
+      if (_isdigit(p[1])) {
         _ret(blepi_consume_number(p), TOKEN_NUMBER);
       } else if (p[1] == '.' && p[2] == '.') {
         _reth(3, TOKEN_OP, MISC_SPREAD);
@@ -404,8 +429,8 @@ static inline void blepi_consume_token(struct token *t, char *p, int *line_no) {
         t->special = 0;
         len = consume_known_lit(p, &(t->special));
 
-        char c = p[len];
-        if (!lookup_symbol[c]) {
+        blep_char c = p[len];
+        if (!_lookup(lookup_symbol, c)) {
           t->type = TOKEN_LIT;
           t->len = len;
           return;
@@ -415,7 +440,7 @@ static inline void blepi_consume_token(struct token *t, char *p, int *line_no) {
     }
 
     case _LOOKUP__SYMBOL: {
-      char c = p[len];  // don't need to check this one, we know it's valid
+      blep_char c = p[len];  // don't need to check this one, we know it's valid
       do {
         if (c != '\\') {
           c = p[++len];
@@ -434,7 +459,7 @@ static inline void blepi_consume_token(struct token *t, char *p, int *line_no) {
         }
         len += group;
         c = p[len];
-      } while (lookup_symbol[c]);
+      } while (_lookup(lookup_symbol, c));
 
       _ret(len, TOKEN_LIT);
     }
@@ -534,6 +559,7 @@ int blep_token_update(int type) {
         return ERROR__INTERNAL;
       }
 #endif
+      _stat(++blep_stats.regexp_flips);
       int len = blepi_consume_slash_regexp(td->curr.p);
       td->at += (len - 1);
       td->curr.len = len;
@@ -548,6 +574,7 @@ int blep_token_update(int type) {
         return ERROR__INTERNAL;
       }
 #endif
+      _stat(++blep_stats.regexp_flips);
       // slash is always length=1, don't remove it
       td->at -= (td->curr.len - 1);
       td->curr.len = 1;
@@ -570,14 +597,16 @@ int blep_token_next() {
     td->at += void_len;
 
     // save as we can't yet write p/line_no to `td->curr`
-    char *p = td->at;
+    blep_char *p = td->at;
     int line_no = td->line_no;
+    blep_char *line_at = td->line_at;
 
     blepi_consume_token(&(td->curr), td->at, &(td->line_no));
     td->at += td->curr.len;
 
     td->curr.p = p;
     td->curr.line_no = line_no;
+    td->curr.lp = line_at;
   }
 
   if (!td->curr.len) {
@@ -596,6 +625,7 @@ int blep_token_next() {
 }
 
 int blep_token_peek() {
+  _stat(++blep_stats.peeks);
   if (td->peek.p) {
     // we need to allow duplicate peeks for a few cases
     return td->peek.type;
@@ -607,6 +637,7 @@ int blep_token_peek() {
 
   td->peek.p = td->at;
   td->peek.line_no = td->line_no;
+  td->peek.lp = td->line_at;
   blepi_consume_token(&(td->peek), td->at, &(td->line_no));
   td->at += td->peek.len;
 
@@ -617,6 +648,7 @@ int blep_token_set_restore() {
   if (td->restore__at) {
     return 0;
   }
+  _stat(++blep_stats.restores);
 
   // clear peek and reset its contribution
   if (td->peek.p) {
@@ -640,6 +672,7 @@ int blep_token_set_restore() {
   memcpy(&(td->restore__curr), &(td->curr), sizeof(struct token));
 
   td->restore__line_no = td->line_no;
+  td->restore__line_at = td->line_at;
   td->restore__at = td->at;
   td->restore__depth = td->depth;
   return td->depth;
@@ -654,9 +687,11 @@ int blep_token_restore() {
   // but we could/should store a ring buffer of ~256 tokens for re-parsing
   // challenges are with looping again/overflows: we enact tokens in consume 
 
+  _stat(blep_stats.relexed += td->at - td->restore__at);
   memcpy(&(td->curr), &(td->restore__curr), sizeof(struct token));
 
   td->line_no = td->restore__line_no;
+  td->line_at = td->restore__line_at;
   td->at = td->restore__at;
   td->depth = td->restore__depth;
 
@@ -666,3 +701,51 @@ int blep_token_restore() {
 
   return td->depth;
 }
+
+// finds the UTF-16 adjustment (bytes minus UTF-16 units) before the passed pointer. This only moves
+// forward from the last call, so it's cheap when called on every token in order. ASCII is skipped
+// a word at a time, so the cost is largely in non-ASCII input.
+static int blepi_utf16_adjust(blep_char *to) {
+#ifdef BLEP_UTF16
+  (void) to;
+  return 0;
+#else
+  if (to < td->utf16__at) {
+    td->utf16__at = td->start;
+    td->utf16__adjust = 0;
+  }
+
+  char *p = td->utf16__at;
+  int adjust = td->utf16__adjust;
+
+  while (p < to) {
+    uint64_t word;
+    if (to - p >= 8 && (memcpy(&word, p, 8), !(word & 0x8080808080808080ULL))) {
+      p += 8;
+      continue;
+    }
+
+    unsigned char c = *p++;
+    if (c & 0x80) {
+      // continuation bytes aren't units, but 4-byte sequences are a surrogate pair (two units)
+      adjust += ((c & 0xc0) == 0x80) - ((c & 0xf8) == 0xf0);
+    }
+  }
+
+  td->utf16__at = p;
+  td->utf16__adjust = adjust;
+  return adjust;
+#endif
+}
+
+int blep_token_column(struct token *t) {
+  if (t->lp != td->utf16__line) {
+    td->utf16__line_adjust = blepi_utf16_adjust(t->lp);
+    td->utf16__line = t->lp;
+  }
+  return (t->p - t->lp) - (blepi_utf16_adjust(t->p) - td->utf16__line_adjust);
+}
+
+int blep_token_utf16(struct token *t) {
+  return (t->p - td->start) - blepi_utf16_adjust(t->p);
+}
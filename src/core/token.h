@@ -6,16 +6,17 @@
 #include "def.h"
 
 struct token {
-  char *vp;  // void-pointer (before token)
-  char *p;
+  blep_char *vp;  // void-pointer (before token)
+  blep_char *p;
   int len;
   int line_no;
   int type;
   uint32_t special;
+  blep_char *lp;  // start of line containing p
 };
 
 
-int blep_token_init(char *, int);
+int blep_token_init(blep_char *, int);
 int blep_token_update(int);
 int blep_token_next();
 int blep_token_peek();
@@ -23,6 +24,9 @@ int blep_token_peek();
 int blep_token_set_restore();
 int blep_token_restore();
 
+int blep_token_column(struct token *);
+int blep_token_utf16(struct token *);
+
 
 #define STACK_SIZE    256
 
@@ -32,9 +36,11 @@ typedef struct {
   struct token curr;  // cursor before head
   struct token peek;  // also before head if p is !NULL
 
-  int line_no;  // line_no at head
-  char *at;     // head pointer
-  char *end;    // end of input (must point to NULL)
+  int line_no;          // line_no at head
+  blep_char *line_at;   // start of line at head
+  blep_char *at;        // head pointer
+  blep_char *start;     // start of input
+  blep_char *end;       // end of input (must point to NULL)
 
   // depth/stack at head (just used for balancing)
   int depth;
@@ -42,8 +48,15 @@ typedef struct {
 
   struct token restore__curr;
   int restore__line_no;
-  char *restore__at;
+  blep_char *restore__line_at;
+  blep_char *restore__at;
   int restore__depth;
+
+  // lazily computed UTF-16 adjustment (bytes minus UTF-16 units) at a pointer, and for a line
+  blep_char *utf16__at;
+  int utf16__adjust;
+  blep_char *utf16__line;
+  int utf16__line_adjust;
 } tokendef;
 
 // global
@@ -54,4 +67,19 @@ extern tokendef _td;
 #define td (&_td)
 #endif
 
+// finds a unit in the input, as memchr() only operates on bytes
+#ifdef BLEP_UTF16
+static inline blep_char *blep_memchr(blep_char *p, int c, int len) {
+  blep_char *end = p + len;
+  for (; p < end; ++p) {
+    if (*p == c) {
+      return p;
+    }
+  }
+  return 0;
+}
+#else
+#define blep_memchr memchr
+#endif
+
 #endif//__BLEP_TOKEN_H
@@ -0,0 +1,11 @@
+// A build of the parser without callbacks or open/close hooks, for fast syntax validation via
+// blep_validate(). This shares the grammar in parser.c, but has its own statics.
+
+#define BLEP_VALIDATE
+
+// the grammar's warnings are already reported when compiling parser.c itself
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-value"
+#pragma GCC diagnostic ignored "-Wunused-variable"
+#include "parser.c"
+#pragma GCC diagnostic pop
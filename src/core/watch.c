@@ -0,0 +1,132 @@
+#include <string.h>
+#include "watch.h"
+#include "intern.h"
+
+#ifdef EMSCRIPTEN
+#include <emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+// A small set of names (e.g., "require", "process") that the parser filters on before firing its
+// callback, so hosts only hear about tokens they care about. Names are copied into static storage
+// and outlive any one parse.
+
+#define WATCH_MAX         128   // names
+#define WATCH_SLOTS       256   // must be a power of two, at least double WATCH_MAX
+#define WATCH_UNITS       4096  // total name storage
+
+struct watch_slot {
+  uint32_t hash;
+  int index;  // plus one, so zeroed slots are empty
+};
+
+int blep_watch_active;
+
+static struct watch_slot watch_slots[WATCH_SLOTS];
+static struct intern_name watch_names[WATCH_MAX];
+static int watch_count;
+static blep_char watch_units[WATCH_UNITS];
+static int watch_units_used;
+static int watch_reserved;
+
+static uint32_t watch_require;
+static uint32_t watch_exclude;
+
+// finds the slot for this name: either holding it, or empty where it should go
+static inline struct watch_slot *watch_find(blep_char *p, int len, uint32_t hash) {
+  int at = hash & (WATCH_SLOTS - 1);
+  for (;;) {
+    struct watch_slot *slot = &watch_slots[at];
+    if (!slot->index) {
+      return slot;
+    }
+    struct intern_name *name = &watch_names[slot->index - 1];
+    if (slot->hash == hash && name->len == len) {
+      int i = 0;
+      while (i < len && name->p[i] == p[i]) {
+        ++i;
+      }
+      if (i == len) {
+        return slot;
+      }
+    }
+    at = (at + 1) & (WATCH_SLOTS - 1);
+  }
+}
+
+// clears all names and filters, so every token fires the callback again
+EMSCRIPTEN_KEEPALIVE
+void blep_watch_clear() {
+  memset(watch_slots, 0, sizeof(watch_slots));
+  watch_count = 0;
+  watch_units_used = 0;
+  watch_reserved = 0;
+  watch_require = 0;
+  watch_exclude = 0;
+  blep_watch_active = 0;
+}
+
+// returns storage for the next name of len units, or NULL if full
+EMSCRIPTEN_KEEPALIVE
+blep_char *blep_watch_reserve(int len) {
+  if (len <= 0 || watch_count == WATCH_MAX || watch_units_used + len > WATCH_UNITS) {
+    return 0;
+  }
+  watch_reserved = len;
+  return watch_units + watch_units_used;
+}
+
+// adds the name written to blep_watch_reserve, returning its index (reusing any previous index for
+// the same name), and enables filtering
+EMSCRIPTEN_KEEPALIVE
+int blep_watch_add() {
+  if (!watch_reserved) {
+    return ERROR__INTERNAL;
+  }
+  blep_char *p = watch_units + watch_units_used;
+  int len = watch_reserved;
+  watch_reserved = 0;
+  blep_watch_active = 1;
+
+  uint32_t hash = blep_intern_hash(p, len);
+  struct watch_slot *slot = watch_find(p, len, hash);
+  if (slot->index) {
+    return slot->index - 1;
+  }
+
+  int index = watch_count++;
+  watch_units_used += len;
+  slot->hash = hash;
+  slot->index = index + 1;
+  watch_names[index].p = p;
+  watch_names[index].len = len;
+  return index;
+}
+
+// only match tokens which have all special bits in require, and none in exclude
+EMSCRIPTEN_KEEPALIVE
+void blep_watch_filter(uint32_t require, uint32_t exclude) {
+  watch_require = require;
+  watch_exclude = exclude;
+}
+
+// returns the index of the watched name for this token, or -1
+int blep_watch_match(struct token *t) {
+  if (!blep_watch_active) {
+    return -1;
+  }
+  switch (t->type) {
+    case TOKEN_LIT:
+    case TOKEN_SYMBOL:
+    case TOKEN_KEYWORD:
+      break;
+
+    default:
+      return -1;
+  }
+  if ((t->special & watch_require) != watch_require || (t->special & watch_exclude)) {
+    return -1;
+  }
+  return watch_find(t->p, t->len, blep_intern_hash(t->p, t->len))->index - 1;
+}
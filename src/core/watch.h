@@ -0,0 +1,14 @@
+#ifndef __BLEP_WATCH_H
+#define __BLEP_WATCH_H
+
+#include "token.h"
+
+void blep_watch_clear();
+blep_char *blep_watch_reserve(int);
+int blep_watch_add();
+void blep_watch_filter(uint32_t, uint32_t);
+int blep_watch_match(struct token *);
+
+extern int blep_watch_active;
+
+#endif//__BLEP_WATCH_H
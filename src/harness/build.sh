@@ -8,6 +8,16 @@ if [[ "${1-}" == "release" ]]; then
   export EMCC_DEBUG=0
   FLAGS="-O2 -DSPEED"
   echo "Release mode (\"${FLAGS}\")" >&2
+elif [[ "${1-}" == "stats" ]]; then
+  # release, but with counters for harness.stats()
+  export EMCC_DEBUG=0
+  FLAGS="-O2 -DSPEED -DBLEP_STATS"
+  echo "Stats mode (\"${FLAGS}\")" >&2
+elif [[ "${1-}" == "profile" ]]; then
+  # release, but timing grammar and tokenizer functions for harness.profile()
+  export EMCC_DEBUG=0
+  FLAGS="-O2 -DSPEED -DBLEP_PROFILE"
+  echo "Profile mode (\"${FLAGS}\")" >&2
 elif [[ "${1-}" != "" ]]; then
   echo "Unknown mode: $1" >&2
   exit 1
@@ -31,15 +41,23 @@ fi
 MEMORY=65536
 STACK=2048
 
-emcc $FLAGS \
-  -s SIDE_MODULE=2 \
-  -s ALLOW_MEMORY_GROWTH=0 \
-  -s SUPPORT_LONGJMP=0 \
-  -s ERROR_ON_UNDEFINED_SYMBOLS=0 \
-  -s INITIAL_MEMORY=${MEMORY} \
-  -s TOTAL_STACK=${STACK} \
-  -o runner.wasm \
-  *.c ../core/*.c
-
-chmod -x runner.wasm
-echo "Ok! => runner.wasm"
+# build the default UTF-8 runner, and one which reads UTF-16 code units (i.e., JS strings)
+build() {
+  local OUT=$1
+  shift
+  emcc $FLAGS "$@" \
+    -s SIDE_MODULE=2 \
+    -s ALLOW_MEMORY_GROWTH=0 \
+    -s SUPPORT_LONGJMP=0 \
+    -s ERROR_ON_UNDEFINED_SYMBOLS=0 \
+    -s INITIAL_MEMORY=${MEMORY} \
+    -s TOTAL_STACK=${STACK} \
+    -o ${OUT} \
+    *.c ../core/*.c
+
+  chmod -x ${OUT}
+  echo "Ok! => ${OUT}"
+}
+
+build runner.wasm
+build runner16.wasm -DBLEP_UTF16
@@ -5,13 +5,14 @@
 #include <string.h>  // just for types
 
 // Confirm struct padding as the JS uses it to read values directly.
-static_assert(sizeof(struct token) == 24, "`struct token` should be 24 bytes");
+static_assert(sizeof(struct token) == 28, "`struct token` should be 28 bytes");
 static_assert(__builtin_offsetof(struct token, vp) == 0, "vp=0");
 static_assert(__builtin_offsetof(struct token, p) == 4, "p=4");
 static_assert(__builtin_offsetof(struct token, len) == 8, "len=8");
 static_assert(__builtin_offsetof(struct token, line_no) == 12, "line_no=12");
 static_assert(__builtin_offsetof(struct token, type) == 16, "type=16");
 static_assert(__builtin_offsetof(struct token, special) == 20, "special=20");
+static_assert(__builtin_offsetof(struct token, lp) == 24, "lp=24");
 
 int isdigit(int c) {
   return (c >= '0' && c <= '9');
@@ -23,15 +23,18 @@ import * as blep from './types/index.js';
 const PAGE_SIZE = 65536;
 const WRITE_AT = PAGE_SIZE * 2;
 const ERROR_CONTEXT_MAX = 256;  // display this much text on either side
-const TOKEN_WORD_COUNT = 6;
-
-const safeEval = eval;  // try to avoid global side-effects with rename
+const TOKEN_WORD_COUNT = 7;
+const TOKEN_MAX = 16;  // _TOKEN_MAX in def.h
+const STACK_MAX = 11;  // _STACK_MAX in def.h
+const STATS_WORD_COUNT = (TOKEN_MAX + 1) + (STACK_MAX + 1) + 6;  // struct blep_stats
 
 export const noop = () => {};
 /** @type {blep.Handlers} */
 const defaultHandlers = {callback: noop, open: noop, close: noop};
 
 const decoder = new TextDecoder('utf-8');
+const decoder16 = new TextDecoder('utf-16le');
+const encoder = new TextEncoder();
 
 const errorMap = new Map();
 errorMap.set(-1, 'unexpected');
@@ -39,13 +42,39 @@ errorMap.set(-2, 'stack');
 errorMap.set(-3, 'internal');
 Object.freeze(errorMap);
 
-import {string as stringType} from './types/v-types.js';
+import {string as stringType, number as numberType} from './types/v-types.js';
+
+/**
+ * @param {WebAssembly.Memory} memory
+ * @param {blep.InternalImports} imports
+ * @return {WebAssembly.Imports}
+ */
+function buildImportObject(memory, imports) {
+  const env = {
+    memory,
+    __memory_base: PAGE_SIZE,  // put Emscripten 'stack' at start of memory, not really used
+    ...imports,
+  };
+  return {env};
+}
+
+/**
+ * @param {WebAssembly.Instance} instance
+ * @return {blep.InternalCalls}
+ */
+function prepareCalls(instance) {
+  const calls = /** @type {blep.InternalCalls} */ (/** @type {unknown} */ (instance.exports));
+
+  // emscripten creates __post_instantiate to configure statics
+  calls.__post_instantiate();
+  return calls;
+}
 
 /**
- * @param {Promise<BufferSource>|BufferSource} modulePromise
+ * @param {Promise<BufferSource|WebAssembly.Module>|BufferSource|WebAssembly.Module} modulePromise
  * @param {blep.InternalImports} imports
  * @return {Promise<{
- *   instance: WebAssembly.Instance,
+ *   module: WebAssembly.Module,
  *   memory: WebAssembly.Memory,
  *   calls: blep.InternalCalls,
  * }>}
@@ -53,37 +82,85 @@ import {string as stringType} from './types/v-types.js';
 async function initialize(modulePromise, imports) {
   const memory = new WebAssembly.Memory({initial: 2});
 
-  const env = {
-    memory,
-    __memory_base: PAGE_SIZE,  // put Emscripten 'stack' at start of memory, not really used
-    ...imports,
-  };
-  const importObject = {env};
+  // keep the compiled module, so the harness can be recycled later without compiling again
+  const source = await modulePromise;
+  const module = source instanceof WebAssembly.Module ? source : await WebAssembly.compile(source);
+  const instance = await WebAssembly.instantiate(module, buildImportObject(memory, imports));
 
-  const module = await modulePromise;
-  const instantiatedSource = await WebAssembly.instantiate(module, importObject);
-  const {instance} = instantiatedSource;
+  return {module, memory, calls: prepareCalls(instance)};
+}
 
-  // In the browser, the exports appear on instantiatedSource; in Node, they're on instance.
-  // @ts-ignore
-  const calls = /** @type {blep.InternalCalls} */ (instantiatedSource.exports || instance.exports);
+/**
+ * Creates a new instance with fresh memory, synchronously. This is fine in Node, but browsers may
+ * disallow it on their main thread.
+ *
+ * @param {WebAssembly.Module} module
+ * @param {blep.InternalImports} imports
+ * @return {{memory: WebAssembly.Memory, calls: blep.InternalCalls}}
+ */
+function reinitialize(module, imports) {
+  const memory = new WebAssembly.Memory({initial: 2});
+  const instance = new WebAssembly.Instance(module, buildImportObject(memory, imports));
+  return {memory, calls: prepareCalls(instance)};
+}
 
-  // emscripten creates __post_instantiate to configure statics
-  calls.__post_instantiate();
+/**
+ * Builds a harness over a runner which reads UTF-8 input.
+ *
+ * @param {Promise<BufferSource|WebAssembly.Module>|BufferSource|WebAssembly.Module} modulePromise
+ * @param {Partial<blep.HarnessOptions>} options
+ * @return {Promise<blep.Harness<Uint8Array>>}
+ */
+export default async function build(modulePromise, options = {}) {
+  return /** @type {blep.Harness<Uint8Array>} */ (await internalBuild(modulePromise, false, options));
+}
 
-  return {instance, memory, calls};
+/**
+ * Builds a harness over a runner compiled with BLEP_UTF16, which reads UTF-16 code units. Offsets
+ * and lengths reported by its token are then indexes into the source JS string.
+ *
+ * @param {Promise<BufferSource|WebAssembly.Module>|BufferSource|WebAssembly.Module} modulePromise
+ * @param {Partial<blep.HarnessOptions>} options
+ * @return {Promise<blep.Harness<Uint16Array>>}
+ */
+export async function build16(modulePromise, options = {}) {
+  return /** @type {blep.Harness<Uint16Array>} */ (await internalBuild(modulePromise, true, options));
 }
 
 /**
- * @param {Promise<BufferSource>|BufferSource} modulePromise
- * @return {Promise<blep.Harness>}
+ * @param {Promise<BufferSource|WebAssembly.Module>|BufferSource|WebAssembly.Module} modulePromise
+ * @param {boolean} utf16
+ * @param {Partial<blep.HarnessOptions>} options
+ * @return {Promise<blep.Harness<Uint8Array|Uint16Array>>}
  */
-export default async function build(modulePromise) {
+async function internalBuild(modulePromise, utf16, {highWaterMark = 0} = {}) {
   let {callback, open, close} = defaultHandlers;
+  const shift = utf16 ? 1 : 0;  // bytes per unit, as a shift
 
   // These views need to be mutable as they'll point to a new WebAssembly.Memory when it gets
-  // resized for a new run.
+  // resized for a new run. The units view is the same as the byte view for UTF-8.
   let view = new Uint8Array(0);
+  /** @type {Uint8Array|Uint16Array} */
+  let units = view;
+
+  // Source string, if passed via prepareString() in UTF-16 mode. Tokens are then just slices.
+  /** @type {string?} */
+  let source = null;
+
+  /**
+   * @param {number} start unit index into memory
+   * @param {number} end unit index into memory
+   * @return {string}
+   */
+  const decodeUnits = utf16 ?
+    (start, end) => {
+      if (source !== null) {
+        const base = WRITE_AT >> 1;
+        return source.substring(start - base, end - base);
+      }
+      return decoder16.decode(units.subarray(start, end));
+    } :
+    (start, end) => decoder.decode(view.subarray(start, end));
 
   /** @type {blep.InternalImports} */
   const imports = {
@@ -93,6 +170,19 @@ export default async function build(modulePromise) {
       return s;
     },
 
+    memcpy(dst, src, n) {
+      refresh();  // C may have just grown the arena
+      view.copyWithin(dst, src, src + n);
+      return dst;
+    },
+
+    memmove(dst, src, n) {
+      // nb. This only happens once per run, to move the import map.
+      refresh();
+      view.copyWithin(dst, src, src + n);
+      return dst;
+    },
+
     memchr(ptr, char, len) {
       const index = view.subarray(ptr, ptr + len).indexOf(char);
       if (index === -1) {
@@ -101,27 +191,103 @@ export default async function build(modulePromise) {
       return ptr + index;
     },
 
+    blep_number_slow(ptr, len) {
+      // nb. Only for long or extreme literals, so allocating a string here is fine.
+      const at = ptr >> shift;
+      return Number(decodeUnits(at, at + len).replace(/_/g, ''));
+    },
+
+    blep_profile_now() {
+      // nb. Only called by runners built with profiling.
+      return performance.now();
+    },
+
+    // nb. C may have grown memory (e.g., allocating splices) since handlers last ran.
+
     blep_parser_callback() {
+      refresh();
       callback();
     },
 
     blep_parser_open(type) {
+      refresh();
       // if specifically returns false, skip this stack
       return open(type) === false ? 1 : 0;
     },
 
     blep_parser_close(type) {
+      refresh();
       close(type);
     },
   };
 
-  const {memory, calls} = await initialize(modulePromise, imports);
-
-  const {
-    blep_parser_init: parser_init,
-    blep_parser_run: parser_run,
-    blep_parser_cursor: parser_cursor,
-  } = calls;
+  const initialized = await initialize(modulePromise, imports);
+  const {module} = initialized;
+  let {memory, calls} = initialized;
+
+  // calls are bound into locals, and again if the harness is recycled
+  let parser_init, parser_run, parser_cursor, parser_cursor_column, parser_cursor_utf16,
+      parser_cursor_cook, parser_cursor_number, parser_cursor_id, intern_count, intern_names,
+      parser_cursor_watch, watch_clear, watch_reserve, watch_add, watch_filter, define_clear,
+      define_reserve, define_add, splice_count, splice_list, splice_add, splice_assemble,
+      splice_output, splice_segments, splice_reset, intern_reset, importmap_clear,
+      importmap_size, importmap_reserve, importmap_scope, importmap_add, importmap_importer,
+      arena_alloc, arena_init, arena_scratch, stats_get, profile_count, profile_name,
+      profile_functions, profile_node_count, profile_nodes, validate, minify_enable, minify_output,
+      minify_length, sourcemap_enable, sourcemap_build, sourcemap_output;
+  const bindCalls = () => {
+    ({
+      blep_parser_init: parser_init,
+      blep_parser_run: parser_run,
+      blep_parser_cursor: parser_cursor,
+      blep_parser_cursor_column: parser_cursor_column,
+      blep_parser_cursor_utf16: parser_cursor_utf16,
+      blep_parser_cursor_cook: parser_cursor_cook,
+      blep_parser_cursor_number: parser_cursor_number,
+      blep_parser_cursor_id: parser_cursor_id,
+      blep_intern_count: intern_count,
+      blep_intern_names: intern_names,
+      blep_parser_cursor_watch: parser_cursor_watch,
+      blep_watch_clear: watch_clear,
+      blep_watch_reserve: watch_reserve,
+      blep_watch_add: watch_add,
+      blep_watch_filter: watch_filter,
+      blep_define_clear: define_clear,
+      blep_define_reserve: define_reserve,
+      blep_define_add: define_add,
+      blep_splice_count: splice_count,
+      blep_splice_list: splice_list,
+      blep_splice_add: splice_add,
+      blep_splice_assemble: splice_assemble,
+      blep_splice_output: splice_output,
+      blep_splice_segments: splice_segments,
+      blep_splice_reset: splice_reset,
+      blep_intern_reset: intern_reset,
+      blep_importmap_clear: importmap_clear,
+      blep_importmap_size: importmap_size,
+      blep_importmap_reserve: importmap_reserve,
+      blep_importmap_scope: importmap_scope,
+      blep_importmap_add: importmap_add,
+      blep_importmap_importer: importmap_importer,
+      blep_arena_alloc: arena_alloc,
+      blep_arena_init: arena_init,
+      blep_arena_scratch: arena_scratch,
+      blep_stats_get: stats_get,
+      blep_profile_count: profile_count,
+      blep_profile_name: profile_name,
+      blep_profile_functions: profile_functions,
+      blep_profile_node_count: profile_node_count,
+      blep_profile_nodes: profile_nodes,
+      blep_validate: validate,
+      blep_minify_enable: minify_enable,
+      blep_minify_output: minify_output,
+      blep_minify_length: minify_length,
+      blep_sourcemap_enable: sourcemap_enable,
+      blep_sourcemap_build: sourcemap_build,
+      blep_sourcemap_output: sourcemap_output,
+    } = calls);
+  };
+  bindCalls();
 
   const tokenAt = parser_cursor();
   if (tokenAt >= WRITE_AT) {
@@ -130,14 +296,93 @@ export default async function build(modulePromise) {
 
   let tokenView = new Int32Array(memory.buffer, tokenAt, TOKEN_WORD_COUNT);
   let inputSize = 0;
+  let input = units;
+
+  let peak = memory.buffer.byteLength;
+  let recycles = 0;
+
+  // Configuration held in the C statics (e.g., watched names), replayed if the harness is recycled.
+  /** @type {Map<string, () => void>} */
+  const persisted = new Map();
+
+  // Memory can grow on prepare, or when the C code allocates working memory after the input. This
+  // recreates all views if that has happened.
+  const refresh = () => {
+    if (view.buffer === memory.buffer) {
+      return;
+    }
+    tokenView = new Int32Array(memory.buffer, tokenAt, TOKEN_WORD_COUNT);  // in 32-bit
+    view = new Uint8Array(memory.buffer);
+    peak = Math.max(peak, view.length);
+    units = utf16 ? new Uint16Array(memory.buffer) : view;
+    input = units.subarray(WRITE_AT >> shift, (WRITE_AT >> shift) + inputSize);
+  };
+
+  /**
+   * @param {number} size in units
+   */
+  const setInputSize = (size) => {
+    // first, as this moves anything kept in the arena (which may overlap the input), and can grow
+    arena_init(WRITE_AT + ((size + 1) << shift), 0);
+    refresh();
+
+    units[(WRITE_AT >> shift) + size] = 0;  // null-terminate
+    inputSize = size;
+    input = units.subarray(WRITE_AT >> shift, (WRITE_AT >> shift) + size);
+
+    // these live in the arena, so drop them too (e.g., to splice without a run)
+    splice_reset();
+    intern_reset();
+  };
+
+  /**
+   * Encodes a string into units for this harness, e.g. to write into memory.
+   *
+   * @param {string} s
+   * @return {Uint8Array|Uint16Array}
+   */
+  const encodeUnits = utf16 ?
+    (s) => {
+      const out = new Uint16Array(s.length);
+      for (let i = 0; i < s.length; ++i) {
+        out[i] = s.charCodeAt(i);
+      }
+      return out;
+    } :
+    (s) => encoder.encode(s);
+
+  setInputSize(0);
+
+  /**
+   * Copies strings one after the other into reserved storage, returning their lengths.
+   *
+   * @param {(size: number) => number} reserve
+   * @param {string[]} parts
+   * @return {number[]}
+   */
+  const writeReserved = (reserve, ...parts) => {
+    const encoded = parts.map(encodeUnits);
+    const size = encoded.reduce((size, part) => size + part.length, 0);
+    let at = reserve(size);
+    if (!at) {
+      throw new Error(`Can't write ${JSON.stringify(parts[0])}, storage is full`);
+    }
+    refresh();  // reserving can grow memory
+    at >>= shift;
+    for (const part of encoded) {
+      units.set(part, at);
+      at += part.length;
+    }
+    return encoded.map(({length}) => length);
+  };
 
   const token = /** @type {blep.Token} */ ({
     void() {
-      return tokenView[0] - WRITE_AT;
+      return (tokenView[0] - WRITE_AT) >> shift;
     },
 
     at() {
-      return tokenView[1] - WRITE_AT;
+      return (tokenView[1] - WRITE_AT) >> shift;
     },
 
     length() {
@@ -148,6 +393,14 @@ export default async function build(modulePromise) {
       return tokenView[3];
     },
 
+    column() {
+      return parser_cursor_column();
+    },
+
+    utf16Offset() {
+      return parser_cursor_utf16();
+    },
+
     type() {
       return tokenView[4];
     },
@@ -156,19 +409,35 @@ export default async function build(modulePromise) {
       return tokenView[5];
     },
 
+    id() {
+      const id = parser_cursor_id();
+      refresh();
+      if (id < -1) {
+        throw new Error(`Can't id() on token, internal error: ${id}`);
+      }
+      return id;
+    },
+
+    watch() {
+      return parser_cursor_watch();
+    },
+
     view() {
-      return view.subarray(tokenView[1], tokenView[1] + tokenView[2]);
+      const at = tokenView[1] >> shift;
+      return units.subarray(at, at + tokenView[2]);
     },
 
     string() {
-      return decoder.decode(view.subarray(tokenView[1], tokenView[1] + tokenView[2]));
+      const at = tokenView[1] >> shift;
+      return decodeUnits(at, at + tokenView[2]);
     },
 
     stringValue() {
       if (tokenView[4] !== stringType) {
         throw new TypeError('Can\'t stringValue() on non-string');
       }
-      const target = view.subarray(tokenView[1], tokenView[1] + tokenView[2]);
+      const at = tokenView[1] >> shift;
+      const target = units.subarray(at, at + tokenView[2]);
 
       switch (target[0]) {
         case 96:
@@ -181,29 +450,404 @@ export default async function build(modulePromise) {
           throw new TypeError('Can\'t stringValue() on template string with holes');
       }
 
-      return safeEval(decoder.decode(target));
+      // cook into scratch memory after the input, which is never longer than the token itself
+      const out = arena_scratch(tokenView[2] << shift);
+      const length = parser_cursor_cook(out);
+      refresh();
+      if (length < 0 || !out) {
+        throw new TypeError(`Can't stringValue() on invalid string: ${token.string()}`);
+      }
+      if (utf16) {
+        return decoder16.decode(units.subarray(out >> 1, (out >> 1) + length));
+      }
+      return decoder.decode(view.subarray(out, out + length));
+    },
+
+    numberValue() {
+      if (tokenView[4] !== numberType) {
+        throw new TypeError('Can\'t numberValue() on non-number');
+      }
+      const at = tokenView[1] >> shift;
+      const length = tokenView[2];
+      if (units[at + length - 1] === 110) {  // "n" suffix, so BigInt
+        try {
+          return BigInt(decodeUnits(at, at + length - 1).replace(/_/g, ''));
+        } catch (e) {
+          return NaN;
+        }
+      }
+      return parser_cursor_number();
     },
   });
 
-  return {
+  const recycle = () => {
+    peak = Math.max(peak, memory.buffer.byteLength);
+    ({memory, calls} = reinitialize(module, imports));
+    bindCalls();
+    ++recycles;
+
+    refresh();
+    setInputSize(0);
+    persisted.forEach((replay) => replay());
+  };
+
+  /**
+   * @param {number} size in units
+   * @return {Uint8Array|Uint16Array}
+   */
+  const prepare = (size) => {
+    const memoryNeeded = WRITE_AT + ((size + 1) << shift);
+
+    // Memory never shrinks, so drop it (and the instance) if it's grown past the mark for an
+    // earlier input, but this input fits.
+    if (highWaterMark && memory.buffer.byteLength > highWaterMark && memoryNeeded <= highWaterMark) {
+      recycle();
+    }
+
+    if (memory.buffer.byteLength < memoryNeeded) {
+      memory.grow(Math.ceil((memoryNeeded - memory.buffer.byteLength) / PAGE_SIZE));
+    }
+
+    refresh();
+    setInputSize(size);
+    source = null;
+    return input;
+  };
+
+  /**
+   * Builds an error for a failed parse at the cursor.
+   *
+   * @param {number} ret
+   * @return {TypeError}
+   */
+  const parseError = (ret) => {
+    const at = tokenView[1] >> shift;
+
+    // Special-case crash on a NULL byte. There was no more input.
+    if (units[at] === 0) {
+      return new TypeError(`Unexpected end of input`);
+    }
+
+    // Otherwise, generate a sane error.
+    const lineNo = tokenView[3];
+    const {line, pos, offset} = lineAround(units, at, WRITE_AT >> shift, utf16 ? decoder16 : decoder);
+    const errorType = errorMap.get(ret) || `(? ${ret})`;
+    return new TypeError(`[${lineNo}:${pos}] ${errorType}:\n${line}\n${'^'.padStart(offset + 1)}`);
+  };
+
+  const harness = {
     token,
+    prepare,
+
+    input() {
+      return input;
+    },
+
+    /**
+     * @return {blep.MemoryUsage}
+     */
+    memory() {
+      const current = memory.buffer.byteLength;
+      return {current, peak: Math.max(peak, current), recycles};
+    },
+
+    /**
+     * @param {string[]} names
+     * @param {Partial<blep.WatchOptions>} options
+     */
+    watch(names, {require = 0, exclude = 0} = {}) {
+      for (const name of names) {
+        if (!name || name.includes('.')) {
+          throw new TypeError(`Can't watch ${JSON.stringify(name)}, names must be single tokens`);
+        }
+      }
+      persisted.set('watch', () => harness.watch(names, {require, exclude}));
+      watch_clear();
+      refresh();
+
+      for (const name of names) {
+        writeReserved(watch_reserve, name);
+        watch_add();
+      }
+
+      watch_filter(require, exclude);
+    },
+
+    /**
+     * @param {{[key: string]: string}} defines
+     */
+    define(defines) {
+      persisted.set('define', () => harness.define(defines));
+      define_clear();
+      refresh();
+
+      for (const key in defines) {
+        const [keySize, valueSize] = writeReserved(define_reserve, key, defines[key]);
+        if (define_add(keySize, valueSize) < 0) {
+          throw new TypeError(`Can't define invalid key: ${JSON.stringify(key)}`);
+        }
+      }
+    },
+
+    /**
+     * @param {blep.ImportMap} map
+     * @param {Partial<blep.ImportMapOptions>} options
+     */
+    importMap(map, {suffix = () => ''} = {}) {
+      persisted.set('importMap', () => harness.importMap(map, {suffix}));
+      importmap_clear();
+
+      // check every entry and count what's needed, so the map can be sized up front
+      /** @type {[string, [string, string, string][]][]} */
+      const scopes = [];
+      let entryCount = 0;
+      let keyUnits = 0;
+      let otherUnits = 0;
+
+      /**
+       * @param {string} prefix
+       * @param {{[key: string]: string}} imports
+       */
+      const collect = (prefix, imports) => {
+        /** @type {[string, string, string][]} */
+        const entries = [];
+        for (const key in imports) {
+          const value = imports[key];
+          const s = suffix(value) || '';
+          if (/[\\'"\n\r\u2028\u2029]/.test(value + s)) {
+            throw new TypeError(`Can't map ${JSON.stringify(key)} to unsafe value: ${JSON.stringify(value + s)}`);
+          }
+          entries.push([key, value, s]);
+          keyUnits += encodeUnits(key).length;
+          otherUnits += encodeUnits(value + s).length;
+        }
+        otherUnits += encodeUnits(prefix).length;
+        entryCount += entries.length;
+        scopes.push([prefix, entries]);
+      };
+      collect('', map.imports || {});
+      for (const prefix in map.scopes || {}) {
+        collect(prefix, map.scopes[prefix]);
+      }
+
+      if (importmap_size(scopes.length - 1, entryCount, keyUnits, otherUnits) < 0) {
+        throw new Error(`Can't allocate import map`);
+      }
+      refresh();
+
+      scopes.forEach(([prefix, entries], i) => {
+        if (i) {
+          const [size] = writeReserved(importmap_reserve, prefix);
+          if (importmap_scope(size) < 0) {
+            throw new Error(`Can't add scope ${JSON.stringify(prefix)}`);
+          }
+        }
+        for (const [key, value, s] of entries) {
+          const [keySize, valueSize, suffixSize] = writeReserved(importmap_reserve, key, value, s);
+          if (importmap_add(keySize, valueSize, suffixSize) < 0) {
+            throw new Error(`Can't map ${JSON.stringify(key)}`);
+          }
+        }
+      });
+    },
+
+    /**
+     * @param {string} url
+     */
+    importer(url) {
+      persisted.set('importer', () => harness.importer(url));
+      refresh();
+      const [size] = writeReserved(importmap_reserve, url);
+      if (importmap_importer(size) < 0) {
+        throw new Error(`Can't set importer`);
+      }
+    },
+
+    /**
+     * @param {boolean} enabled
+     */
+    sourceMaps(enabled) {
+      persisted.set('sourceMaps', () => harness.sourceMaps(enabled));
+      sourcemap_enable(enabled ? 1 : 0);
+    },
+
+    /**
+     * @return {blep.Stats?}
+     */
+    stats() {
+      if (!stats_get) {
+        return null;
+      }
+      const words = new Int32Array(memory.buffer, stats_get(), STATS_WORD_COUNT);
+      const tokens = Array.from(words.subarray(0, TOKEN_MAX + 1));
+      const stacks = Array.from(words.subarray(TOKEN_MAX + 1, TOKEN_MAX + STACK_MAX + 2));
+      const [maxDepth, peeks, restores, relexed, regexpFlips, callbacks] = words.subarray(TOKEN_MAX + STACK_MAX + 2);
+      return {tokens, stacks, maxDepth, peeks, restores, relexed, regexpFlips, callbacks};
+    },
+
+    /**
+     * @return {blep.Profile?}
+     */
+    profile() {
+      if (!profile_count) {
+        return null;
+      }
+      refresh();
+
+      const count = profile_count();
+      const names = new Array(count);
+      for (let i = 0; i < count; ++i) {
+        const at = profile_name(i);
+        names[i] = decoder.decode(view.subarray(at, view.indexOf(0, at)));
+      }
+
+      // struct profile_function is {double inclusive, exclusive; int calls, active}
+      const functionsAt = profile_functions();
+      const functionDoubles = new Float64Array(memory.buffer, functionsAt, count * 3);
+      const functionWords = new Int32Array(memory.buffer, functionsAt, count * 6);
+
+      /** @type {blep.ProfileFunction[]} */
+      const functions = [];
+      for (let i = 0; i < count; ++i) {
+        const calls = functionWords[i * 6 + 4];
+        if (calls) {
+          functions.push({name: names[i], calls, inclusive: functionDoubles[i * 3], exclusive: functionDoubles[i * 3 + 1]});
+        }
+      }
+      functions.sort((a, b) => b.exclusive - a.exclusive);
+
+      // struct profile_node is {double self; int parent, function, child, sibling}, and parents
+      // are always before their children
+      const nodeCount = profile_node_count();
+      const nodesAt = profile_nodes();
+      const nodeDoubles = new Float64Array(memory.buffer, nodesAt, nodeCount * 3);
+      const nodeWords = new Int32Array(memory.buffer, nodesAt, nodeCount * 6);
+
+      const paths = [''];
+      const folded = [];
+      for (let i = 1; i < nodeCount; ++i) {
+        const parent = nodeWords[i * 6 + 2];
+        const name = names[nodeWords[i * 6 + 3]];
+        paths[i] = parent ? `${paths[parent]};${name}` : name;
+
+        const us = Math.floor(nodeDoubles[i * 3] * 1e3);
+        if (us > 0) {
+          folded.push(`${paths[i]} ${us}\n`);
+        }
+      }
+
+      return {functions, folded: folded.join('')};
+    },
 
     /**
-     * @param {number} size
-     * @return {Uint8Array}
+     * @param {number} index
+     * @return {blep.Splice?}
      */
-    prepare(size) {
-      const memoryNeeded = WRITE_AT + size + 1;
-      if (memory.buffer.byteLength < memoryNeeded) {
-        memory.grow(Math.ceil((memoryNeeded - memory.buffer.byteLength) / PAGE_SIZE));
+    splice(index) {
+      if (index >= splice_count()) {
+        return null;
+      }
+      refresh();
+      const words = new Int32Array(memory.buffer, splice_list() + index * 16, 4);
+      const text = words[2] >> shift;
+      return {
+        at: (words[0] - WRITE_AT) >> shift,
+        length: words[1],
+        text: units.subarray(text, text + words[3]),
+      };
+    },
+
+    /**
+     * @param {number} at
+     * @param {number} length
+     * @param {string|Uint8Array|Uint16Array} text
+     */
+    addSplice(at, length, text) {
+      let size = text.length;
+      let out = 0;
+
+      if (typeof text === 'string' && !utf16) {
+        // encode directly into the arena: each UTF-16 unit is at most three bytes of UTF-8
+        out = arena_scratch(size * 3);
+        refresh();
+        ({written: size = 0} = encoder.encodeInto(text, view.subarray(out, out + size * 3)));
+        arena_alloc(size);
+      } else {
+        out = arena_alloc(size << shift);
+        refresh();
+        units.set(typeof text === 'string' ? encodeUnits(text) : text, out >> shift);
+      }
+
+      if (!out || splice_add(WRITE_AT + (at << shift), length, out, size) < 0) {
+        throw new Error(`Can't splice, out of memory`);
       }
+    },
+
+    assemble() {
+      const size = splice_assemble(WRITE_AT, inputSize);
+      refresh();
+      if (size < 0) {
+        throw new Error(`Can't assemble, out of memory`);
+      }
+      const out = splice_output() >> shift;
+      return units.subarray(out, out + size);
+    },
+
+    segments() {
+      const count = splice_segments(WRITE_AT, inputSize);
+      refresh();
+      if (count < 0) {
+        throw new Error(`Can't list segments, out of memory`);
+      }
+      const words = new Int32Array(memory.buffer, splice_output(), count * 2);
+      const out = new Array(count);
+      for (let i = 0; i < count; ++i) {
+        const at = words[i * 2] >> shift;
+        out[i] = units.subarray(at, at + words[i * 2 + 1]);
+      }
+      return out;
+    },
+
+    mappings() {
+      const size = sourcemap_build(WRITE_AT, inputSize);
+      refresh();
+      if (size < 0) {
+        throw new Error(`Can't build source map, out of memory`);
+      }
+      const out = sourcemap_output();
+      return decoder.decode(view.subarray(out, out + size));
+    },
 
-      tokenView = new Int32Array(memory.buffer, tokenAt, TOKEN_WORD_COUNT);  // in 32-bit
-      view = new Uint8Array(memory.buffer);
-      view[WRITE_AT + size] = 0;  // null-terminate
-      inputSize = size;
+    names() {
+      const count = intern_count();
+      const names = new Int32Array(memory.buffer, intern_names(), count * 2);
+      const out = new Array(count);
+      for (let i = 0; i < count; ++i) {
+        const at = names[i * 2] >> shift;
+        out[i] = decodeUnits(at, at + names[i * 2 + 1]);
+      }
+      return out;
+    },
+
+    /**
+     * @param {string} s
+     * @return {Uint8Array|Uint16Array}
+     */
+    prepareString(s) {
+      if (utf16) {
+        const out = prepare(s.length);
+        for (let i = 0; i < s.length; ++i) {
+          out[i] = s.charCodeAt(i);
+        }
+        source = s;
+        return out;
+      }
 
-      return new Uint8Array(memory.buffer, WRITE_AT, size);
+      // encode directly into memory: each UTF-16 unit is at most three bytes of UTF-8
+      const out = /** @type {Uint8Array} */ (prepare(s.length * 3));
+      const {written = 0} = encoder.encodeInto(s, out);
+      setInputSize(written);
+      return input;
     },
 
     /**
@@ -229,22 +873,32 @@ export default async function build(modulePromise) {
       if (ret === 0) {
         return statements;
       }
-      const at = tokenView[1];
-      const view = new Uint8Array(memory.buffer);
+      throw parseError(ret);
+    },
 
-      // Special-case crash on a NULL byte. There was no more input.
-      if (view[at] === 0) {
-        throw new TypeError(`Unexpected end of input`);
+    validate() {
+      const ret = validate(WRITE_AT, inputSize);
+      if (ret !== 0) {
+        throw parseError(ret);
       }
+    },
 
-      // Otherwise, generate a sane error.
-      const lineNo = tokenView[3];
-      const {line, pos, offset} = lineAround(view, at, WRITE_AT);
-      const errorType = errorMap.get(ret) || `(? ${ret})`;
-      throw new TypeError(`[${lineNo}:${pos}] ${errorType}:\n${line}\n${'^'.padStart(offset + 1)}`);
+    minify() {
+      // every statement must be visited, so run without the caller's handlers
+      ({callback, open, close} = defaultHandlers);
+      minify_enable(1);
+      try {
+        harness.run();
+      } finally {
+        minify_enable(0);
+      }
+      refresh();
+      const out = minify_output() >> shift;
+      return units.subarray(out, out + minify_length());
     },
 
   };
+  return harness;
 }
 
 /**
@@ -269,12 +923,13 @@ export function stringFrom(view) {
 }
 
 /**
- * @param {Uint8Array} view
+ * @param {Uint8Array|Uint16Array} view
  * @param {number} at of error or character
  * @param {number} writeAt start of buffer
+ * @param {TextDecoder} decoder
  * @return {{line: string, pos: number, offset: number}}
  */
-function lineAround(view, at, writeAt) {
+function lineAround(view, at, writeAt, decoder) {
   let lineAt = at;
   while (--lineAt >= writeAt) {
     if (view[lineAt] === 10) {
@@ -292,7 +947,6 @@ function lineAround(view, at, writeAt) {
     lineView = lineView.subarray(0, lineTo);
   }
 
-  const decoder = new TextDecoder('utf-8');
   const line = decoder.decode(lineView);
 
   return {
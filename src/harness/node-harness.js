@@ -22,14 +22,26 @@
 import * as blep from './types/index.js';
 
 export * from './harness.js';
-import build from './harness.js';
+import build, {build16} from './harness.js';
 
 import * as fs from 'fs';
 
 /**
+ * @param {Partial<blep.HarnessOptions>} options
  * @return {!Promise<blep.Harness>}
  */
-export default async function wrapper() {
+export default async function wrapper(options = {}) {
   const {pathname} = new URL('./runner.wasm', import.meta.url);
-  return build(fs.readFileSync(pathname));
+  return build(fs.readFileSync(pathname), options);
+}
+
+/**
+ * Builds a harness which reads UTF-16 code units, e.g. a JS string passed to `prepareString()`.
+ *
+ * @param {Partial<blep.HarnessOptions>} options
+ * @return {!Promise<blep.Harness<Uint16Array>>}
+ */
+export async function wrapper16(options = {}) {
+  const {pathname} = new URL('./runner16.wasm', import.meta.url);
+  return build16(fs.readFileSync(pathname), options);
 }
@@ -26,8 +26,42 @@ import * as fs from 'fs';
 import {noop} from './harness.js';
 
 
-const PENDING_BUFFER_MAX = 1024 * 16;
-const encoder = new TextEncoder();
+const IOV_MAX = 1024;  // most platforms limit the number of buffers per writev
+
+
+/**
+ * Writes all parts to the file descriptor, in batches of vectored writes.
+ *
+ * @param {number} fd
+ * @param {Uint8Array[]} parts
+ * @return {number} bytes written
+ */
+function writevAll(fd, parts) {
+  let total = 0;
+
+  for (let i = 0; i < parts.length; ) {
+    const batch = parts.slice(i, i + IOV_MAX);
+    let written = fs.writevSync(fd, batch);
+    total += written;
+    i += batch.length;
+
+    // short write (e.g., to a pipe): finish this batch part-by-part
+    for (const part of batch) {
+      if (written >= part.length) {
+        written -= part.length;
+        continue;
+      }
+      for (let at = written; at < part.length; ) {
+        const more = fs.writeSync(fd, part, at);
+        at += more;
+        total += more;
+      }
+      written = 0;
+    }
+  }
+
+  return total;
+}
 
 
 /**
@@ -35,54 +69,35 @@ const encoder = new TextEncoder();
  * @return {blep.RewriterReturn}
  */
 export default function wrapper(harness) {
-  const {prepare, token, run: internalRun, handle} = harness;
+  const {prepare, token, run: internalRun, handle, addSplice, assemble, segments, define, importMap, importer, sourceMaps, mappings} = harness;
 
   /**
+   * Parses the file and records updates as splices, alongside those from C (e.g., defines).
+   *
    * @param {string} f
    * @param {Partial<blep.RewriterArgs>} args
    */
-  const run = (f, {callback = noop, stack = noop, write = noop}) => {
-    const fd = fs.openSync(f, 'r');
-    const stat = fs.fstatSync(fd);
-
-    const buffer = prepare(stat.size);
-    const read = fs.readSync(fd, buffer, 0, stat.size, 0);
-    if (read !== stat.size) {
-      throw new Error(`did not read all bytes at once: ${read}/${stat.size}`);
+  const parse = (f, {callback = noop, stack = noop, importer: url = '', sourceMap, source}) => {
+    if (source) {
+      prepare(source.length).set(source);
+    } else {
+      const fd = fs.openSync(f, 'r');
+      const stat = fs.fstatSync(fd);
+
+      const buffer = prepare(stat.size);
+      const read = fs.readSync(fd, buffer, 0, stat.size, 0);
+      fs.closeSync(fd);
+      if (read !== stat.size) {
+        throw new Error(`did not read all bytes at once: ${read}/${stat.size}`);
+      }
     }
 
-    let sent = 0;
-
     handle({
       callback() {
-        const p = token.at();
-
         const update = callback();
-        if (update === undefined) {
-          if (p - sent > PENDING_BUFFER_MAX) {
-            // send some data, we've gone through a lot
-            write(buffer.subarray(sent, p));
-            sent = p;
-          }
-          return;
+        if (update !== undefined) {
+          addSplice(token.at(), token.length(), update);
         }
-
-        // bump to high water mark
-        if (sent !== p) {
-          write(buffer.subarray(sent, p));
-        }
-
-        // write update
-        if (update.length) {
-          if (typeof update === 'string') {
-            write(encoder.encode(update));
-          } else {
-            write(update);
-          }
-        }
-
-        // move past the "original" string
-        sent = p + token.length();
       },
 
       open: stack,
@@ -93,14 +108,52 @@ export default function wrapper(harness) {
       },
     });
 
+    importer(url);
+    sourceMaps(Boolean(sourceMap));
     internalRun();
-    if (sent !== buffer.length) {
-      write(buffer.subarray(sent, buffer.length));
+  };
+
+  /**
+   * Passes the source map of the output, if requested, with mappings built in C. This doesn't need
+   * the output itself, so is called before it's assembled (which would be invalidated by growth).
+   *
+   * @param {string} f
+   * @param {Partial<blep.RewriterArgs>} args
+   */
+  const emitSourceMap = (f, {sourceMap}) => {
+    if (sourceMap) {
+      sourceMap({version: 3, sources: [f], names: [], mappings: mappings()});
     }
   };
 
   return {
-    run,
+    /**
+     * @param {string} f
+     * @param {Partial<blep.RewriterArgs>} args
+     */
+    run(f, args = {}) {
+      parse(f, args);
+      emitSourceMap(f, args);
+
+      // the output is assembled in one pass at the end
+      const out = assemble();
+      (args.write || noop)(out);
+      return out;
+    },
+
+    /**
+     * @param {string} f
+     * @param {number} fd
+     * @param {Partial<blep.RewriterArgs>} args
+     */
+    runTo(f, fd, args = {}) {
+      parse(f, args);
+      emitSourceMap(f, args);
+      return writevAll(fd, segments());
+    },
+
+    define,
+    importMap,
     token,
   };
 }
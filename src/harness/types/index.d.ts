@@ -14,7 +14,6 @@
  * the License.
  */
 
-
 /**
  * Enum of valid token types.
  */
@@ -33,7 +32,62 @@ export interface InternalCalls {
 
   blep_parser_init(at: number, len: number): number;
   blep_parser_run(): number;
+  blep_validate(at: number, len: number): number;
   blep_parser_cursor(): number;
+  blep_parser_cursor_column(): number;
+  blep_parser_cursor_utf16(): number;
+  blep_parser_cursor_cook(out: number): number;
+  blep_parser_cursor_number(): number;
+  blep_parser_cursor_id(): number;
+
+  blep_intern_count(): number;
+  blep_intern_names(): number;
+
+  blep_parser_cursor_watch(): number;
+  blep_watch_clear(): void;
+  blep_watch_reserve(size: number): number;
+  blep_watch_add(): number;
+  blep_watch_filter(require: number, exclude: number): void;
+
+  blep_define_clear(): void;
+  blep_define_reserve(size: number): number;
+  blep_define_add(keySize: number, valueSize: number): number;
+
+  blep_splice_count(): number;
+  blep_splice_list(): number;
+  blep_splice_add(at: number, len: number, text: number, textLen: number): number;
+  blep_splice_assemble(at: number, len: number): number;
+  blep_splice_output(): number;
+  blep_splice_segments(at: number, len: number): number;
+  blep_splice_reset(): void;
+  blep_intern_reset(): void;
+
+  blep_importmap_clear(): void;
+  blep_importmap_size(scopes: number, entries: number, keyUnits: number, units: number): number;
+  blep_importmap_reserve(size: number): number;
+  blep_importmap_scope(size: number): number;
+  blep_importmap_add(keySize: number, valueSize: number, suffixSize: number): number;
+  blep_importmap_importer(size: number): number;
+
+  blep_arena_init(at: number, size: number): void;
+  blep_arena_alloc(size: number): number;
+  blep_arena_scratch(size: number): number;
+
+  blep_minify_enable(active: number): void;
+  blep_minify_output(): number;
+  blep_minify_length(): number;
+
+  blep_sourcemap_enable(active: number): void;
+  blep_sourcemap_build(at: number, len: number): number;
+  blep_sourcemap_output(): number;
+
+  blep_stats_get?(): number;
+
+  blep_profile_count?(): number;
+  blep_profile_name?(index: number): number;
+  blep_profile_functions?(): number;
+  blep_profile_node_count?(): number;
+  blep_profile_nodes?(): number;
 }
 
 /**
@@ -41,8 +95,20 @@ export interface InternalCalls {
  */
 export interface InternalImports {
   memset(at: number, byte: number, size: number): void;
+  memcpy(dst: number, src: number, size: number): number;
+  memmove(dst: number, src: number, size: number): number;
   memchr(at: number, byte: number, size: number): number;
 
+  /**
+   * Correctly rounded conversion for numeric literals outside the C fast path.
+   */
+  blep_number_slow(at: number, len: number): number;
+
+  /**
+   * Current time in ms, for runners built with profiling.
+   */
+  blep_profile_now(): number;
+
   blep_parser_callback(): void;
   blep_parser_open(type: StackValues): 0 | 1;
   blep_parser_close(type: StackValues): void;
@@ -60,7 +126,8 @@ export interface Handlers {
   callback: () => void;
 
   /**
-   * A stack is being opened. Return false if you'd like to skip it and its close.
+   * A stack is being opened. Return false if you'd like to skip it and its close. This only skips
+   * handlers: defines, import maps, minifying and source maps still see its tokens.
    */
   open: (stack: StackValues) => boolean|void;
 
@@ -71,7 +138,6 @@ export interface Handlers {
 
 }
 
-
 /**
  * An interface to the current token. This will change what it is pointing to, when the parser
  * moves its head as it just reflects the current token.
@@ -81,6 +147,9 @@ export interface Token {
   /**
    * The location in the code immediately after the previous token. Between the void and at
    * locations, it's possible be empty, whitespace only, or contain many comments.
+   *
+   * Locations and lengths are in bytes for UTF-8 input, or in code units (JS string indexes) for
+   * UTF-16 input.
    */
   void(): number;
 
@@ -99,6 +168,18 @@ export interface Token {
    */
   lineNo(): number;
 
+  /**
+   * The column of this token within its line, in UTF-16 code units (as used by editors and source
+   * maps). This is cheapest when called on tokens in order.
+   */
+  column(): number;
+
+  /**
+   * The location of this token in UTF-16 code units, i.e., an index into the source as a JS string.
+   * This is cheapest when called on tokens in order.
+   */
+  utf16Offset(): number;
+
   /**
    * The type of this token.
    */
@@ -112,20 +193,180 @@ export interface Token {
   special(): number;
 
   /**
-   * Finds the current subarray for this token, based on its location and length.
+   * Returns a small ID for the current name-like token (lit or symbol), shared by all tokens with
+   * the same source text in this run, or -1 for other tokens. IDs are assigned in the order first
+   * requested, so they are stable for a run but not across runs.
+   */
+  id(): number;
+
+  /**
+   * Returns the index of the current token in the watchlist (see `Harness.watch()`), or -1.
    */
-  view(): Uint8Array;
+  watch(): number;
 
   /**
-   * Decodes as UTF-8 to a raw string the current subarray for this token.
+   * Finds the current subarray for this token, based on its location and length. This is a
+   * `Uint16Array` for UTF-16 input.
+   */
+  view(): Uint8Array|Uint16Array;
+
+  /**
+   * Decodes to a raw string the current subarray for this token. For UTF-16 input passed via
+   * `prepareString()`, this is just a slice of the source.
    */
   string(): string;
 
   /**
-   * Evaluates the current string token into a JS string (i.e., removes quotes and escapes). Throws
-   * if pointing to a non-string, or a template string with holes.
+   * Cooks the current string token into a JS string (i.e., removes quotes and escapes). Throws if
+   * pointing to a non-string, an invalid escape, or a template string with holes.
    */
   stringValue(): string;
+
+  /**
+   * Decodes the current numeric token into its value, without allocating a string in most cases.
+   * Returns a `bigint` for literals with the "n" suffix. Throws if pointing to a non-number, and
+   * returns `NaN` for invalid literals.
+   *
+   * The value isn't part of the token view (which would grow every token): it's decoded in C when
+   * asked for, and returned directly as a double.
+   */
+  numberValue(): number|bigint;
+}
+
+export interface Splice {
+
+  /**
+   * Offset of the replaced input, in units.
+   */
+  at: number;
+
+  /**
+   * Units of input replaced.
+   */
+  length: number;
+
+  /**
+   * Replacement text, as a view into memory.
+   */
+  text: Uint8Array|Uint16Array;
+}
+
+export interface ImportMap {
+  imports?: {[key: string]: string};
+  scopes?: {[prefix: string]: {[key: string]: string}};
+}
+
+export interface ImportMapOptions {
+
+  /**
+   * Returns text to append to specifiers mapped to this value, e.g. "?v=abc123". For keys ending
+   * with "/", this is appended after the rest of the specifier.
+   */
+  suffix(value: string): string|undefined;
+}
+
+export interface WatchOptions {
+
+  /**
+   * Special flags (e.g., `specials.property`) that must all be set on a watched token.
+   */
+  require: number;
+
+  /**
+   * Special flags that must not be set on a watched token.
+   */
+  exclude: number;
+}
+
+export interface SourceMap {
+  version: 3;
+  sources: string[];
+  names: string[];
+  mappings: string;
+}
+
+export interface Stats {
+
+  /**
+   * Tokens emitted (i.e., not inside a skipped stack) by type.
+   */
+  tokens: number[];
+
+  /**
+   * Stacks opened by type.
+   */
+  stacks: number[];
+
+  maxDepth: number;
+  peeks: number;
+
+  /**
+   * Lookahead restore points taken, and the units lexed again after restoring them.
+   */
+  restores: number;
+  relexed: number;
+
+  /**
+   * Tokens the parser changed between regexp and divide.
+   */
+  regexpFlips: number;
+  callbacks: number;
+}
+
+export interface ProfileFunction {
+  name: string;
+  calls: number;
+
+  /**
+   * Time in ms including callees, but not counting recursive calls twice.
+   */
+  inclusive: number;
+
+  /**
+   * Time in ms excluding callees.
+   */
+  exclusive: number;
+}
+
+export interface Profile {
+
+  /**
+   * Called functions, slowest (by exclusive time) first.
+   */
+  functions: ProfileFunction[];
+
+  /**
+   * Folded stacks of exclusive time in microseconds, one per line, e.g. for flamegraph.pl.
+   */
+  folded: string;
+}
+
+export interface HarnessOptions {
+
+  /**
+   * Memory in bytes above which the harness is recycled: when an earlier input has grown memory
+   * past this, and the next input fits under it, a new instance with fresh memory replaces the old
+   * one. Configuration (watch, define, import map) is replayed. Zero (the default) never recycles.
+   */
+  highWaterMark: number;
+}
+
+export interface MemoryUsage {
+
+  /**
+   * Bytes of Web Assembly memory held now.
+   */
+  current: number;
+
+  /**
+   * Most bytes held at once, across recycles.
+   */
+  peak: number;
+
+  /**
+   * Times the harness has been recycled.
+   */
+  recycles: number;
 }
 
 export interface Base {
@@ -142,6 +383,13 @@ export interface Base {
    */
   run(): number;
 
+  /**
+   * Checks the syntax of the entire source, throwing the same errors as `run()`. This uses a build
+   * of the parser without any handlers, so it's faster than running with none set. It shares the
+   * parser's state, so can't be called from a handler during `run()`.
+   */
+  validate(): void;
+
   /**
    * Replaces any number of handlers with passed handlers.
    * 
@@ -151,27 +399,178 @@ export interface Base {
 
 }
 
-export interface Harness extends Base {
+export interface Harness<T extends Uint8Array|Uint16Array = Uint8Array> extends Base {
 
   /**
    * Prepares the parser for parsing. Returns storage where source should be written.
    *
-   * @param size number of bytes needed
+   * @param size number of units needed (bytes for UTF-8, code units for UTF-16)
    * @returns storage to write to
    */
-  prepare(size: number): Uint8Array;
+  prepare(size: number): T;
+
+  /**
+   * Prepares the parser for parsing and writes the passed source into its storage directly,
+   * without an intermediate buffer.
+   *
+   * @param source to parse
+   * @returns storage that was written to
+   */
+  prepareString(source: string): T;
+
+  /**
+   * Returns the storage holding the prepared input. Memory can grow during a run (e.g., when
+   * cooking strings), so fetch this again rather than holding onto the result of `prepare()`.
+   */
+  input(): T;
+
+  /**
+   * Returns the names interned during the last run via `token.id()`, indexed by their ID.
+   */
+  names(): string[];
+
+  /**
+   * Only fires the callback for tokens matching these names, e.g. "require" or "process". This
+   * persists across runs, and an empty list fires the callback for every token again. Stack
+   * handlers are unaffected.
+   *
+   * Names match single tokens, so a member chain such as "import.meta" throws a `TypeError`: watch
+   * its first part (e.g., "import") and check what follows in the callback.
+   *
+   * @param names to watch, indexed by their position (see `Token.watch()`)
+   * @param options special flags a token must have, or must not have, to match
+   */
+  watch(names: string[], options?: Partial<WatchOptions>): void;
+
+  /**
+   * Replaces member chains with text, e.g. "process.env.NODE_ENV" with `"production"`. Only
+   * chains rooted on a plain reference match, the longest key wins, and chains being assigned to
+   * or updated are left alone. Replacements are recorded as splices (see `splice()`). This
+   * persists across runs, and is not applied inside stacks skipped by handlers.
+   *
+   * @param defines dotted keys to their replacement source text
+   */
+  define(defines: {[key: string]: string}): void;
+
+  /**
+   * Rewrites import and export specifiers with an import map, recording splices (see `splice()`).
+   * Keys match exactly, or as a prefix if they end with "/", and the longest key wins. Specifiers
+   * are matched as written, not resolved as URLs. This persists across runs.
+   *
+   * @param map standard import map, with optional scopes (see `importer()`)
+   * @param options e.g. to append a content hash to each value for cache-busting
+   */
+  importMap(map: ImportMap, options?: Partial<ImportMapOptions>): void;
+
+  /**
+   * Sets the URL of the file about to be parsed, which selects the import map scopes to use.
+   */
+  importer(url: string): void;
+
+  /**
+   * Returns a splice recorded during the last run, in input order, or null if there are no more.
+   */
+  splice(index: number): Splice|null;
+
+  /**
+   * Records a splice replacing input, in units. Splices should be added in input order (e.g., for
+   * the current token during a callback), and any starting before the end of the previous one are
+   * dropped on assembly.
+   *
+   * @param at offset of input to replace
+   * @param length units of input to replace
+   * @param text replacement, copied into memory
+   */
+  addSplice(at: number, length: number, text: string|T): void;
+
+  /**
+   * Assembles the input with all splices applied into one contiguous buffer. This is a view into
+   * memory, valid until the next prepare.
+   */
+  assemble(): T;
+
+  /**
+   * Lists the input with all splices applied as segments of input and replacements, without
+   * copying, e.g. for a gathered write. These are views into memory, valid until the next prepare.
+   */
+  segments(): T[];
+
+  /**
+   * Runs the parser over the entire source and returns it without comments or unneeded whitespace.
+   * Splices are ignored. Clears handlers on finish. This is a view into memory, valid until the
+   * next prepare.
+   */
+  minify(): T;
+
+  /**
+   * Records where each token came from on future runs, so `mappings()` can describe the output.
+   */
+  sourceMaps(enabled: boolean): void;
+
+  /**
+   * Returns the "mappings" of a source map from the output of the last run to its input, with
+   * columns in UTF-16 units. This describes the minified output if the run was `minify()`, and
+   * otherwise the input with splices applied. Replaced tokens map from their replacement.
+   *
+   * This allocates working memory, so may invalidate views from `assemble()` or `segments()`.
+   */
+  mappings(): string;
+
+  /**
+   * Reports Web Assembly memory held by this harness. Memory grows to fit the largest input (plus
+   * working memory) and never shrinks, unless recycled (see `HarnessOptions`).
+   */
+  memory(): MemoryUsage;
+
+  /**
+   * Returns counters from the last run, or null if the runner wasn't built with stats (see
+   * `build.sh stats`).
+   */
+  stats(): Stats|null;
+
+  /**
+   * Returns per-function timings from the last run, or null if the runner wasn't built with
+   * profiling (see `build.sh profile`).
+   */
+  profile(): Profile|null;
 
 }
 
 export interface RewriterArgs {
+
+  /**
+   * URL of the file being rewritten, to select import map scopes. Defaults to "" (no scopes).
+   */
+  importer: string;
   callback(): Uint8Array|string|void;
   stack(type: StackValues): boolean|void;
   write(part: Uint8Array): void;
+
+  /**
+   * Receives a source map for the output, built as tokens are parsed.
+   */
+  sourceMap(map: SourceMap): void;
+
+  /**
+   * Source already read from the file (e.g., to hash it), which is parsed instead of reading again.
+   */
+  source: Uint8Array;
 }
 
 export interface RewriterReturn {
-  run(file: string, args?: Partial<RewriterArgs>): void;
-  token: Token;
-}
 
+  /**
+   * Rewrites a file, passing the complete output to `write()` once. Also returns the output, which
+   * is a view into memory valid until the next run.
+   */
+  run(file: string, args?: Partial<RewriterArgs>): Uint8Array;
 
+  /**
+   * Rewrites a file directly to a file descriptor, with vectored writes over the untouched input
+   * and replacements in memory. Returns the number of bytes written.
+   */
+  runTo(file: string, fd: number, args?: Partial<Omit<RewriterArgs, 'write'>>): number;
+  define(defines: {[key: string]: string}): void;
+  importMap(map: ImportMap, options?: Partial<ImportMapOptions>): void;
+  token: Token;
+}
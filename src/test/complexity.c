@@ -0,0 +1,158 @@
+// Parses inputs at doubling sizes for constructs which need lookahead or re-lexing, and fails if
+// parse time grows worse than linearly. "Long" shapes put a single construct around the whole input,
+// so its lookahead covers everything.
+
+#define _POSIX_C_SOURCE 199309L  // clock_gettime
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../core/token.h"
+#include "../core/parser.h"
+
+#define SIZES     5
+#define RUNS      3
+#define BASE      (1 << 13)
+#define THRESHOLD 1.3
+
+typedef struct {
+  const char *name;
+  const char *prefix;
+  const char *repeat;
+  const char *suffix;
+} shapedef;
+
+static shapedef shapes[] = {
+  {"arrow group (flat)", "", "x = (a, b, [c], {d}) + ((e) => f);\n", ""},
+  {"arrow group (long)", "(", "a, (b), [c], ", "z);\n"},
+  {"arrow params (long)", "(", "a, {b}, [c] = 1, ", "z) => 1;\n"},
+  {"destructuring (flat)", "", "[a, {b: [c]}, ...d] = e; ({f, g} = h);\n", ""},
+  {"destructuring (long)", "[", "a, {b: [c]}, ", "] = x;\n"},
+  {"array literal (long)", "[", "a, {b: [c]}, ", "];\n"},
+  {"async (flat)", "", "async(a, b); async (c) => d; async\nfunction f() {}\nx = async => 1;\n", ""},
+  {"async call (long)", "async(", "a, (b), ", "z);\n"},
+  {"regexp/divide (flat)", "", "x = (a) / b / (c) / 2; if (y) /re/g.test(z); {} /re/;\n", ""},
+  {"divide (long line)", "", "(a)/b/(c)/2;", "\n"},
+};
+
+void blep_parser_callback() {
+  // ignore
+}
+
+int blep_parser_open(int type) {
+  return 0;
+}
+
+void blep_parser_close(int type) {
+  // ignore
+}
+
+static double now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// builds the shape with count repeats, returning its length
+static int build_input(shapedef *shape, int count, char **out) {
+  int prefix_len = strlen(shape->prefix);
+  int repeat_len = strlen(shape->repeat);
+  int suffix_len = strlen(shape->suffix);
+  int len = prefix_len + repeat_len * count + suffix_len;
+
+  char *buf = malloc(len + 1);
+  char *p = buf;
+  memcpy(p, shape->prefix, prefix_len);
+  p += prefix_len;
+  for (int i = 0; i < count; ++i) {
+    memcpy(p, shape->repeat, repeat_len);
+    p += repeat_len;
+  }
+  memcpy(p, shape->suffix, suffix_len);
+  buf[len] = 0;
+
+  *out = buf;
+  return len;
+}
+
+// returns the fastest of a few parses, or < 0 for error
+static double time_parse(char *buf, int len) {
+  double best = -1;
+  for (int r = 0; r < RUNS; ++r) {
+    double start = now_ms();
+    int ret = blep_parser_init(buf, len);
+    if (ret >= 0) {
+      do {
+        ret = blep_parser_run();
+      } while (ret > 0);
+    }
+    if (ret < 0) {
+      return ret;
+    }
+
+    double ms = now_ms() - start;
+    if (best < 0 || ms < best) {
+      best = ms;
+    }
+  }
+  return best;
+}
+
+// least-squares slope of log(ms) against log(len)
+static double fit_slope(double *xs, double *ys, int n) {
+  double mx = 0, my = 0;
+  for (int i = 0; i < n; ++i) {
+    mx += log(xs[i]);
+    my += log(ys[i]);
+  }
+  mx /= n;
+  my /= n;
+
+  double num = 0, den = 0;
+  for (int i = 0; i < n; ++i) {
+    num += (log(xs[i]) - mx) * (log(ys[i]) - my);
+    den += (log(xs[i]) - mx) * (log(xs[i]) - mx);
+  }
+  return num / den;
+}
+
+int main() {
+  int count = sizeof(shapes) / sizeof(shapedef);
+  int failed = 0;
+
+  for (int i = 0; i < count; ++i) {
+    shapedef *shape = &shapes[i];
+    double lens[SIZES], times[SIZES];
+
+    int ok = 1;
+    for (int s = 0; s < SIZES; ++s) {
+      char *buf;
+      int len = build_input(shape, BASE << s, &buf);
+      double ms = time_parse(buf, len);
+      free(buf);
+
+      if (ms < 0) {
+        printf("%s: error (%d) at %d bytes\n", shape->name, (int) ms, len);
+        ok = 0;
+        break;
+      }
+      lens[s] = len;
+      times[s] = ms;
+    }
+
+    if (ok) {
+      double slope = fit_slope(lens, times, SIZES);
+      ok = (slope <= THRESHOLD);
+      printf("%s: slope=%.3f (%.0f bytes in %.2fms)%s\n", shape->name, slope, lens[SIZES - 1],
+          times[SIZES - 1], ok ? "" : " SUPER-LINEAR");
+    }
+    if (!ok) {
+      ++failed;
+    }
+  }
+
+  printf("complexity (%d/%d)\n", count - failed, count);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,11 @@
+#!/bin/bash
+
+cd "${BASH_SOURCE%/*}" || exit
+
+set -eu
+
+# nb. optimized, so timings reflect the parser rather than debug overhead
+clang -O2 complexity.c ../core/*.c -lm -o _complexity
+./_complexity || STATUS=$?
+rm _complexity
+exit ${STATUS-0}
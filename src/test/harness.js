@@ -14,15 +14,32 @@
  * the License.
  */
 
-import buildHarness from '../harness/node-harness.js';
+import buildHarness, {wrapper16 as buildHarness16} from '../harness/node-harness.js';
+
 import buildRewriter from '../harness/node-rewriter.js';
-import {specials, types} from '../harness/common.js';
+import {specials, stacks, types} from '../harness/common.js';
 import * as lit from '../tokens/lit.js';
 
 import test from 'ava';
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
 
 const harness = await buildHarness();
-const {run, token} = buildRewriter(harness);
+const {run, runTo, define, token} = buildRewriter(harness);
+
+/**
+ * Prepares ASCII source, padded by a comment so the input ends just before a page: the first thing
+ * allocated after it must grow memory. Use a new harness, as memory never shrinks.
+ *
+ * @param {import('../harness/types/index.js').Harness} h
+ * @param {string} source
+ */
+function prepareAtPageEnd(h, source) {
+  const size = (1 << 16) - 3;  // nb. input starts on a page, and is followed by a NULL
+  const buf = Buffer.from(`${source}\n//`.padEnd(size, 'x'));
+  h.prepare(buf.length).set(buf);
+}
 
 test.serial('simple', (t) => {
   const expected = [
@@ -138,3 +155,466 @@ var a = async () => 123;
 let b = async();
 `);
 });
+
+test.serial('prepareString', (t) => {
+  harness.prepareString('let héllo = "wörld";');
+
+  const tokens = [];
+  harness.handle({
+    callback() {
+      tokens.push([harness.token.at(), harness.token.string()]);
+    },
+  });
+  harness.run();
+
+  t.deepEqual(tokens, [[0, 'let'], [4, 'héllo'], [11, '='], [13, '"wörld"'], [21, ';']]);
+});
+
+test.serial('utf16', async (t) => {
+  const harness16 = await buildHarness16();
+  harness16.prepareString('let héllo = "wörld 😀";');
+
+  const tokens = [];
+  harness16.handle({
+    callback() {
+      tokens.push([harness16.token.at(), harness16.token.length(), harness16.token.string()]);
+    },
+  });
+  harness16.run();
+
+  t.deepEqual(tokens, [[0, 3, 'let'], [4, 5, 'héllo'], [10, 1, '='], [12, 10, '"wörld 😀"'], [22, 1, ';']]);
+});
+
+test.serial('column and utf16Offset', (t) => {
+  const source = 'let é = \'😀\'; x\n/* ü\n */ y + `a\nb😀` + z';
+  harness.prepareString(source);
+
+  const tokens = [];
+  harness.handle({
+    callback() {
+      tokens.push([harness.token.string(), harness.token.column(), harness.token.utf16Offset()]);
+    },
+  });
+  harness.run();
+
+  for (const [s, column, offset] of tokens) {
+    t.is(source.substr(offset, s.length), s);
+    t.is(column, offset - source.lastIndexOf('\n', offset - 1) - 1, `column of ${s}`);
+  }
+  t.is(tokens.length, 11);
+});
+
+test.serial('stringValue', (t) => {
+  const source = String.raw`a('abc', "q\"\x41B\u{1F600}😀\101\
+!", ` + '`x\r\ny\\``, \'\');';
+  harness.prepareString(source);
+
+  const values = [];
+  harness.handle({
+    callback() {
+      if (harness.token.type() === types.string) {
+        values.push(harness.token.stringValue());
+      }
+    },
+  });
+  harness.run();
+
+  t.deepEqual(values, ['abc', 'q"AB😀😀A!', 'x\ny`', '']);
+});
+
+test.serial('numberValue', (t) => {
+  const source = 'a(0, 1.5, .5e1, 1_000, 0xFF, 0o17, 0b101, 1e400, 0.1, 123456789012345678901, 10n, 0x1fn);';
+  harness.prepareString(source);
+
+  const values = [];
+  harness.handle({
+    callback() {
+      if (harness.token.type() === types.number) {
+        values.push(harness.token.numberValue());
+      }
+    },
+  });
+  harness.run();
+
+  t.deepEqual(values, [0, 1.5, 5, 1000, 255, 15, 5, Infinity, 0.1, 123456789012345678901, 10n, 31n]);
+});
+
+test.serial('numberValue radix rounding', (t) => {
+  // past 64 bits, these must still round to nearest (even), including on a dropped low bit
+  const halfway = `0b1${'0'.repeat(52)}1${'0'.repeat(20)}`;
+  const source = `a(${halfway}, ${halfway.slice(0, -1)}1, 0o${'7'.repeat(30)}, 0x${'f'.repeat(300)}, 017, 019, 00);`;
+  harness.prepareString(source);
+
+  const values = [];
+  harness.handle({
+    callback() {
+      if (harness.token.type() === types.number) {
+        values.push(harness.token.numberValue());
+      }
+    },
+  });
+  harness.run();
+
+  t.deepEqual(values, [2 ** 73, 2 ** 73 + 2 ** 21, 2 ** 90, Infinity, 15, 19, 0]);
+});
+
+test.serial('id', (t) => {
+  harness.prepareString('const foo = bar.foo + bar(1, "foo"); ëa.foo;');
+
+  const ids = [];
+  harness.handle({
+    callback() {
+      ids.push(harness.token.id());
+    },
+  });
+  harness.run();
+
+  const names = harness.names();
+  t.deepEqual(names, ['foo', 'bar', 'ëa']);
+  t.deepEqual(ids, [-1, 0, -1, 1, -1, 0, -1, 1, -1, -1, -1, -1, -1, -1, 2, -1, 0, -1]);
+});
+
+test.serial('validate', (t) => {
+  harness.prepareString('const x = (a, {b}) => /re/.test(a) ? `${b}` : [...a];');
+  t.notThrows(() => harness.validate());
+
+  harness.prepareString('var x = {a: 1');
+  t.throws(() => harness.validate(), {instanceOf: TypeError});
+});
+
+test.serial('stats', (t) => {
+  harness.prepareString('x = (a) => a;');
+  harness.run();
+
+  // only available when built with stats
+  const stats = harness.stats();
+  if (stats === null) {
+    t.pass();
+    return;
+  }
+  t.is(stats.callbacks, 8);
+  t.is(stats.restores, 1);
+  t.is(stats.stacks[stacks.function], 1);
+});
+
+test.serial('profile', (t) => {
+  harness.prepareString('x = (a) => a;');
+  harness.run();
+
+  // only available when built with profiling
+  const profile = harness.profile();
+  if (profile === null) {
+    t.pass();
+    return;
+  }
+  const statement = profile.functions.find(({name}) => name === 'consume_statement');
+  t.is(statement?.calls, 1);
+  t.is(typeof profile.folded, 'string');
+});
+
+test('memory recycle', async (t) => {
+  const h = await buildHarness({highWaterMark: 1 << 20});
+  h.watch(['foo']);
+
+  h.prepareString(`foo; // ${'x'.repeat(2 << 20)}`);
+  h.run();
+  const large = h.memory();
+  t.true(large.current > (2 << 20));
+  t.is(large.recycles, 0);
+
+  // a small input drops the large memory, but keeps the watched names
+  h.prepareString('foo; bar;');
+  let count = 0;
+  h.handle({
+    callback() {
+      ++count;
+    },
+  });
+  h.run();
+  t.is(count, 1);
+
+  const small = h.memory();
+  t.true(small.current < (1 << 20));
+  t.is(small.peak, large.peak);
+  t.is(small.recycles, 1);
+});
+
+test('large import map', async (t) => {
+  const h = await buildHarness();
+  const imports = {};
+  for (let i = 0; i < 1000; ++i) {
+    imports[`pkg-${i}`] = `/node_modules/pkg-${i}/index.js`;
+  }
+  h.importMap({imports, scopes: {'/legacy/': {'pkg-999': '/old.js'}}});
+
+  const rewrite = (source) => {
+    h.prepareString(source);
+    h.run();
+    return new TextDecoder().decode(h.assemble());
+  };
+
+  // the map is kept across inputs, including larger ones written over it
+  t.is(rewrite('import "pkg-0";'), 'import "/node_modules/pkg-0/index.js";');
+  const padding = `// ${'x'.repeat(1 << 16)}\n`;
+  t.is(rewrite(`${padding}import "pkg-999";`), `${padding}import "/node_modules/pkg-999/index.js";`);
+
+  h.importer('/legacy/x.js');
+  t.is(rewrite('import "pkg-999"; import "pkg-998";'), 'import "/old.js"; import "/node_modules/pkg-998/index.js";');
+});
+
+test.serial('watch', (t) => {
+  harness.prepareString('const require = 1; require("x"); a.require; var process; process.env;');
+  harness.watch(['require', 'process'], {exclude: specials.property | specials.declare});
+
+  const matches = [];
+  harness.handle({
+    callback() {
+      matches.push([harness.token.string(), harness.token.watch()]);
+    },
+  });
+  harness.run();
+  harness.watch([]);
+
+  t.deepEqual(matches, [['require', 0], ['process', 1]]);
+
+  // chains never match a single token, so they're rejected
+  t.throws(() => harness.watch(['import.meta', 'process']), {instanceOf: TypeError});
+});
+
+test.serial('rewriter define', (t) => {
+  define({'process.env.NODE_ENV': '"development"', 'process.env': '{}'});
+
+  const {pathname} = new URL('data/define.js', import.meta.url);
+  const parts = [];
+  const output = run(pathname, {write: parts.push.bind(parts)});
+  define({});
+
+  t.deepEqual(parts, [output], 'output should be written once');
+  const out = new TextDecoder().decode(output);
+  t.true(out.endsWith(`
+if ("development" !== 'production') {
+  process.env.NODE_ENV = 'test';
+  console.info("development".length, {}.OTHER);
+}
+`));
+});
+
+test.serial('define skips targets', (t) => {
+  const source = `
+for (process.env.X in o);
+[process.env.X, ...process.env.X] = a;
+({a: process.env.X, [process.env.X]: b} = o);
+for ([process.env.X] of a);
+x = [process.env.X, {a: process.env.X}, process.env.X in o];
+`;
+  harness.prepareString(source);
+  harness.define({'process.env.X': 'X'});
+  harness.run();
+  harness.define({});
+
+  t.is(new TextDecoder().decode(harness.assemble()), `
+for (process.env.X in o);
+[process.env.X, ...process.env.X] = a;
+({a: process.env.X, [X]: b} = o);
+for ([process.env.X] of a);
+x = [X, {a: X}, X in o];
+`);
+});
+
+test.serial('define in skipped stacks', (t) => {
+  harness.prepareString('function f() { return process.env.X; }\nif (a) { g(process.env.X); }');
+  harness.define({'process.env.X': 'X'});
+
+  // defines apply even where the handlers skip every stack
+  const names = [];
+  harness.handle({
+    callback() {
+      names.push(harness.token.string());
+    },
+    open() {
+      return false;
+    },
+  });
+  harness.run();
+  harness.define({});
+
+  t.false(names.includes('process'));
+  t.is(new TextDecoder().decode(harness.assemble()), 'function f() { return X; }\nif (a) { g(X); }');
+});
+
+test('define at a page boundary', async (t) => {
+  const h = await buildHarness();
+  h.define({'process.env.NODE_ENV': '"production"'});
+  prepareAtPageEnd(h, 'let x = process.env.NODE_ENV; foo(x);');
+
+  // handlers see memory grown by the define's splice
+  const names = [];
+  h.handle({
+    callback() {
+      names.push(h.token.string());
+    },
+  });
+  h.run();
+  t.deepEqual(names.slice(0, 3), ['let', 'x', '=']);
+  t.true(new TextDecoder().decode(h.assemble()).startsWith('let x = "production"; foo(x);\n'));
+});
+
+test.serial('assemble', (t) => {
+  harness.prepareString('let x = a + bb + "ë";');
+  harness.define({a: 'A'});
+  harness.handle({
+    callback() {
+      const s = harness.token.string();
+      if (s === 'bb' || s === 'a') {
+        harness.addSplice(harness.token.at(), harness.token.length(), s === 'bb' ? '"ü"' : '');
+      }
+    },
+  });
+  harness.run();
+  harness.define({});
+
+  // nb. the host removed "a" first, so the define overlaps and is dropped
+  t.is(new TextDecoder().decode(harness.assemble()), 'let x =  + "ü" + "ë";');
+});
+
+test.serial('minify', (t) => {
+  harness.prepareString('#!/usr/bin/env node\nlet a = 1 /* c */ + + 2 // ë\na\n++b; x = y / /re/g; const é = 1');
+  t.is(new TextDecoder().decode(harness.minify()), '#!/usr/bin/env node\nlet a=1+ +2\na\n++b;x=y/ /re/g;const é=1');
+});
+
+test.serial('source maps', (t) => {
+  harness.sourceMaps(true);
+  try {
+    harness.prepareString('let ë = 1;\n  foo(ë);');
+    harness.handle({
+      callback() {
+        if (harness.token.string() === 'foo') {
+          harness.addSplice(harness.token.at(), harness.token.length(), 'bar.baz');
+        }
+      },
+    });
+    harness.run();
+    t.is(harness.mappings(), 'AAAA,IAAI,EAAE,EAAE,CAAC;EACP,OAAG,CAAC,CAAC,CAAC');
+
+    harness.minify();
+    t.is(harness.mappings(), 'AAAA,IAAI,CAAE,CAAE,CAAC,CACP,GAAG,CAAC,CAAC,CAAC');
+  } finally {
+    harness.sourceMaps(false);
+  }
+});
+
+test.serial('source maps in skipped stacks', (t) => {
+  const source = 'function f() {\n  return 1;\n}\nif (a) { b(); }';
+  harness.sourceMaps(true);
+  try {
+    harness.prepareString(source);
+    harness.run();
+    const expected = harness.mappings();
+
+    // every token is mapped, even where the handlers skip every stack
+    harness.prepareString(source);
+    harness.handle({
+      open() {
+        return false;
+      },
+    });
+    harness.run();
+    t.is(harness.mappings(), expected);
+  } finally {
+    harness.sourceMaps(false);
+  }
+});
+
+test('source maps at a page boundary', async (t) => {
+  const h = await buildHarness();
+  h.sourceMaps(true);
+  prepareAtPageEnd(h, 'let x = 1;');
+
+  // the first mark grows memory before the first callback
+  const seen = [];
+  h.handle({
+    callback() {
+      seen.push([h.token.type(), h.token.at()]);
+    },
+  });
+  h.run();
+  t.deepEqual(seen.slice(0, 2), [[types.keyword, 0], [types.symbol, 4]]);
+  t.true(h.mappings().startsWith('AAAA,IAAI,'));
+});
+
+test.serial('rewriter runTo', (t) => {
+  define({'process.env.NODE_ENV': '"development"'});
+  const {pathname} = new URL('data/define.js', import.meta.url);
+  const expected = new TextDecoder().decode(run(pathname, {}));
+
+  const target = path.join(os.tmpdir(), `blep-runTo-${process.pid}.js`);
+  const fd = fs.openSync(target, 'w');
+  try {
+    const written = runTo(pathname, fd);
+    t.is(written, Buffer.byteLength(expected));
+  } finally {
+    fs.closeSync(fd);
+    define({});
+  }
+
+  t.is(fs.readFileSync(target, 'utf-8'), expected);
+  fs.unlinkSync(target);
+});
+
+test.serial('rewriter importMap', (t) => {
+  const {importMap} = buildRewriter(harness);
+  importMap({
+    imports: {'./real-path': '/node_modules/real/index.js'},
+    scopes: {'/legacy/': {'./real-path': '/node_modules/real1/index.js'}},
+  }, {suffix: (value) => `?v=${value.length}`});
+
+  const {pathname} = new URL('data/imports.js', import.meta.url);
+  const decoder = new TextDecoder();
+  const top = decoder.decode(run(pathname, {}));
+  const scoped = decoder.decode(run(pathname, {importer: '/legacy/x.js'}));
+  importMap({});
+
+  t.is(top, 'import \'/node_modules/real/index.js?v=27\';');
+  t.is(scoped, 'import \'/node_modules/real1/index.js?v=28\';');
+});
+
+test.serial('importMap in skipped stacks', (t) => {
+  harness.importMap({imports: {x: '/x.js'}});
+  harness.prepareString(`import 'x'; export {y} from "x";`);
+
+  // specifiers are mapped even where the handlers skip every stack
+  let callbacks = 0;
+  harness.handle({
+    callback() {
+      ++callbacks;
+    },
+    open() {
+      return false;
+    },
+  });
+  harness.run();
+  harness.importMap({});
+
+  t.is(callbacks, 0);
+  t.is(new TextDecoder().decode(harness.assemble()), `import '/x.js'; export {y} from "/x.js";`);
+});
+
+test.serial('rewriter sourceMap', (t) => {
+  const {pathname} = new URL('data/imports.js', import.meta.url);
+
+  /** @type {import('../harness/types/index.js').SourceMap[]} */
+  const maps = [];
+  const out = run(pathname, {
+    callback() {
+      if (token.type() === types.string) {
+        return '"x"';
+      }
+    },
+    sourceMap(map) {
+      maps.push(map);
+    },
+  });
+
+  t.is(new TextDecoder().decode(out), 'import "x";');
+  t.deepEqual(maps, [{version: 3, sources: [pathname], names: [], mappings: 'AAAA,OAAO,GAAa'}]);
+});
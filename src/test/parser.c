@@ -1,8 +1,10 @@
 
 #include "../core/token.h"
 #include "../core/parser.h"
+#include "../core/stats.h"
 #include <stdio.h>
 #include <strings.h>
+#include <string.h>
 #include <stdlib.h>
 
 typedef struct _testdef {
@@ -16,6 +18,21 @@ typedef struct _testdef {
 static struct token *t;
 static int render_output = 0;
 
+#ifdef BLEP_UTF16
+static blep_char wide_input[4096];
+static char narrow_output[4096];
+
+// narrows the current token for display (test inputs are all ASCII)
+static char *render_token() {
+  for (int i = 0; i < t->len; ++i) {
+    narrow_output[i] = (char) t->p[i];
+  }
+  return narrow_output;
+}
+#else
+#define render_token() (t->p)
+#endif
+
 struct {
   testdef *def;
   int at;
@@ -35,11 +52,11 @@ void blep_parser_callback() {
 
   if (actual != expected) {
     if (render_output) {
-      printf("%d: actual=%d expected=%d `%.*s`\n", active.at, actual, expected, t->len, t->p);
+      printf("%d: actual=%d expected=%d `%.*s`\n", active.at, actual, expected, t->len, render_token());
     }
     active.error = 1;
   } else if (render_output) {
-    printf("%d: ok=%d `%.*s`\n", active.at, actual, t->len, t->p);
+    printf("%d: ok=%d `%.*s`\n", active.at, actual, t->len, render_token());
   }
   ++active.at;
 }
@@ -69,13 +86,32 @@ int run_testdef(testdef *def) {
     printf(">> %s\n", def->name);
   }
 
+  // validate first (as it resets any stats), which should agree with the parser on success
+#ifdef BLEP_UTF16
+  // widen input to UTF-16 units, including its trailing NULL
+  int input_len = strlen(def->input);
+  for (int i = 0; i <= input_len; ++i) {
+    wide_input[i] = (unsigned char) def->input[i];
+  }
+  int validate_ret = blep_validate(wide_input, input_len);
+  int ret = blep_parser_init(wide_input, input_len);
+#else
+  int validate_ret = blep_validate((char *) def->input, strlen(def->input));
   int ret = blep_parser_init((char *) def->input, strlen(def->input));
+#endif
   if (ret >= 0) {
     do {
       ret = blep_parser_run();
     } while (ret > 0);
   }
 
+  if (!ret && validate_ret) {
+    if (render_output) {
+      printf("ERROR: validate failed (%d)\n", validate_ret);
+    }
+    return validate_ret;
+  }
+
   if (ret) {
     if (render_output) {
       printf("ERROR: internal error (%d)\n", ret);
@@ -712,6 +748,38 @@ int main() {
     TOKEN_CLOSE,     // )
   );
 
+#ifdef BLEP_STATS
+  // checks counters from the last run
+  _test("stats", "x = (a) => a;\n[b] = c;\nif (d) /re/;",
+    TOKEN_SYMBOL,    // x
+    TOKEN_OP,        // =
+    TOKEN_PAREN,     // (
+    TOKEN_SYMBOL,    // a
+    TOKEN_CLOSE,     // )
+    TOKEN_OP,        // =>
+    TOKEN_SYMBOL,    // a
+    TOKEN_SEMICOLON, // ;
+    TOKEN_ARRAY,     // [
+    TOKEN_SYMBOL,    // b
+    TOKEN_CLOSE,     // ]
+    TOKEN_OP,        // =
+    TOKEN_SYMBOL,    // c
+    TOKEN_SEMICOLON, // ;
+    TOKEN_KEYWORD,   // if
+    TOKEN_PAREN,     // (
+    TOKEN_SYMBOL,    // d
+    TOKEN_CLOSE,     // )
+    TOKEN_REGEXP,    // /re/
+    TOKEN_SEMICOLON, // ;
+  );
+  if (blep_stats.callbacks != 20 || blep_stats.tokens[TOKEN_SYMBOL] != 6 ||
+      blep_stats.stacks[STACK__FUNCTION] != 1 || blep_stats.restores != 2 ||
+      blep_stats.relexed <= 0 || blep_stats.regexp_flips != 1 || blep_stats.max_depth != 2) {
+    printf("ERROR: unexpected stats\n");
+    err |= 1;
+  }
+#endif
+
   // restate all errors
   render_output = 1;
   testdef *p = &fail;
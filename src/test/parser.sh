@@ -6,3 +6,18 @@ set -eu
 clang parser.c ../core/*.c -o _parser
 ./_parser
 rm _parser
+
+# also run with UTF-16 input
+clang -DBLEP_UTF16 parser.c ../core/*.c -o _parser
+./_parser
+rm _parser
+
+# also run with stats enabled
+clang -DBLEP_STATS parser.c ../core/*.c -o _parser
+./_parser
+rm _parser
+
+# also run with profiling, which shouldn't change results
+clang -DBLEP_PROFILE parser.c ../core/*.c -o _parser
+./_parser
+rm _parser
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+import {crawlGraph, Pool} from '../../src/tool/graph/lib.js';
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+
+import test from 'ava';
+
+/**
+ * @param {{[name: string]: string}} files
+ * @return {string}
+ */
+function writeFiles(files) {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'gumnut-graph-'));
+  for (const name in files) {
+    fs.writeFileSync(path.join(dir, name), files[name]);
+  }
+  return dir;
+}
+
+/**
+ * @param {string} importer
+ * @param {string} specifier
+ */
+function resolve(importer, specifier) {
+  if (specifier.startsWith('.')) {
+    return path.join(path.dirname(importer), specifier);
+  }
+}
+
+for (const workers of [0, 2]) {
+  test(`graph crawler (workers=${workers})`, async (t) => {
+    const dir = writeFiles({
+      'a.js': `import {b} from './b.js'; export * from "./c.js"; import("./d.js"); import('./' + x); import 'node:fs';`,
+      'b.js': `import './a.js'; export const b = 1;`,
+      'c.js': `export {b as c} from './b.js';`,
+      'd.js': `export default import.meta.url;`,
+    });
+
+    const {modules, stats} = await crawlGraph([path.join(dir, 'a.js')], {resolve, workers});
+    t.is(stats.files, 4);
+    t.is(modules.size, 4);
+
+    const a = modules.get(path.join(dir, 'a.js'));
+    t.deepEqual(a?.edges, [
+      {specifier: './b.js', kind: 'static', resolved: path.join(dir, 'b.js')},
+      {specifier: './c.js', kind: 'reexport', resolved: path.join(dir, 'c.js')},
+      {specifier: './d.js', kind: 'dynamic', resolved: path.join(dir, 'd.js')},
+      {specifier: 'node:fs', kind: 'static', resolved: undefined},
+    ]);
+    t.deepEqual(modules.get(path.join(dir, 'c.js'))?.edges.map(({kind}) => kind), ['reexport']);
+    t.deepEqual(modules.get(path.join(dir, 'd.js'))?.edges, []);
+
+    fs.rmSync(dir, {recursive: true});
+  });
+}
+
+test('graph crawler missing file', async (t) => {
+  const dir = writeFiles({'a.js': `import './missing.js';`});
+  const {modules} = await crawlGraph([path.join(dir, 'a.js')], {resolve, workers: 1});
+
+  const missing = modules.get(path.join(dir, 'missing.js'));
+  t.truthy(missing?.error);
+  t.deepEqual(missing?.edges, []);
+
+  fs.rmSync(dir, {recursive: true});
+});
+
+test('graph pool replaces dead workers', async (t) => {
+  const pool = new Pool(1, new URL('data/crash-worker.js', import.meta.url));
+  try {
+    // each scan kills its worker, so the second only finishes if the first was replaced
+    const first = await pool.scan('a.js');
+    const second = await pool.scan('b.js');
+    t.regex(first.error ?? '', /crashed on a\.js/);
+    t.regex(second.error ?? '', /crashed on b\.js/);
+    t.is(pool.workers.length, 1);
+  } finally {
+    await pool.close();
+  }
+});
@@ -14,7 +14,11 @@
  * the License.
  */
 
-import buildImportsRewriter from '../../src/tool/imports/lib.js';
+import buildImportsRewriter, {buildAsyncModuleImportRewriter, ResolverCache, ResultCache, watchModuleImports} from '../../src/tool/imports/lib.js';
+import {affects, resolverDirs} from '../../src/tool/imports/watch.js';
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
 
 import test from 'ava';
 
@@ -34,3 +38,143 @@ test.serial('imports rewriter', async (t) => {
   t.is(out, 'import "lol";');
 });
 
+
+test.serial('async imports rewriter', async (t) => {
+  const run = await buildAsyncModuleImportRewriter((f) => {
+    return async (importee) => `/resolved/${importee}`;
+  });
+
+  const {pathname} = new URL('data/imports.js', import.meta.url);
+  const outputs = await Promise.all([run(pathname), run(pathname)]);
+
+  const decoder = new TextDecoder();
+  for (const out of outputs) {
+    t.is(decoder.decode(out), 'import "/resolved/./real-path";');
+  }
+});
+
+test('resolver cache', (t) => {
+  const cache = new ResolverCache(2);
+  let built = 0;
+  const buildResolver = cache.wrap((importer) => {
+    ++built;
+    return (importee) => `${importer}:${importee}`;
+  });
+
+  t.is(buildResolver('/a/x.js')('react'), '/a/x.js:react');
+  t.is(buildResolver('/a/y.js')('react'), '/a/x.js:react', 'same directory should hit');
+  t.is(built, 1, 'builder is only called on a miss');
+  t.deepEqual(cache.stats(), {hits: 1, misses: 1, size: 1});
+
+  buildResolver('/b/x.js')('react');
+  buildResolver('/a/x.js')('react');  // bumps "/a" to most recent
+  buildResolver('/c/x.js')('react');  // evicts "/b"
+  t.deepEqual(cache.stats(), {hits: 2, misses: 3, size: 2});
+  t.is(buildResolver('/b/z.js')('react'), '/b/z.js:react');
+
+  cache.invalidate((dir) => dir === '/b');
+  t.is(cache.stats().size, 1);
+  cache.invalidate();
+  t.is(cache.stats().size, 0);
+});
+
+test.serial('result cache', async (t) => {
+  const results = new ResultCache({fingerprint: 'test'});
+  let resolved = 0;
+  const run = await buildAsyncModuleImportRewriter((f) => {
+    return (importee) => {
+      ++resolved;
+      return 'lol';
+    };
+  }, {results});
+
+  const {pathname} = new URL('data/imports.js', import.meta.url);
+  const first = await run(pathname);
+  const second = await run(pathname);
+
+  t.deepEqual(first, second, 'unchanged file should return cached output');
+  t.is(resolved, 1);
+  t.like(results.stats(), {hits: 1, misses: 1, hitRate: 0.5, entries: 1, bytes: first.length});
+
+  // the sync rewriter caches too, parsing the same read it hashed
+  const runSync = await buildImportsRewriter(() => () => 'lol', {results: new ResultCache({fingerprint: 'sync'})});
+  /** @type {Uint8Array[]} */
+  const parts = [];
+  runSync(pathname, (part) => parts.push(part.slice()));
+  runSync(pathname, (part) => parts.push(part.slice()));
+  t.deepEqual(parts, [first, first]);
+});
+
+test.serial('watch imports', async (t) => {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'blep-watch-'));
+  const file = path.join(dir, 'a.js');
+  fs.writeFileSync(file, 'import "x";');
+
+  const watcher = await watchModuleImports(() => (importee) => `/${importee}`);
+  try {
+    const decoder = new TextDecoder();
+    t.is(decoder.decode(await watcher.add(file)), 'import "/x";');
+
+    const changed = new Promise((resolve) => {
+      watcher.once('change', (f, output) => resolve([f, decoder.decode(output)]));
+    });
+    fs.writeFileSync(file, 'import "y";');
+    t.deepEqual(await changed, [file, 'import "/y";']);
+  } finally {
+    watcher.close();
+    fs.rmSync(dir, {recursive: true});
+  }
+});
+
+test.serial('watch packages', async (t) => {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'blep-watch-'));
+  const pkg = path.join(dir, 'node_modules', 'x');
+  fs.mkdirSync(pkg, {recursive: true});
+  fs.writeFileSync(path.join(pkg, 'a.js'), '');
+  fs.writeFileSync(path.join(pkg, 'b.js'), '');
+  fs.writeFileSync(path.join(pkg, 'package.json'), '{"main": "a.js"}');
+  const file = path.join(dir, 'index.js');
+  fs.writeFileSync(file, 'import "x";');
+
+  // resolves from package.json, so only a watch on the package sees it change
+  const buildResolver = () => (importee) => {
+    const {main} = JSON.parse(fs.readFileSync(path.join(dir, 'node_modules', importee, 'package.json'), 'utf-8'));
+    return `./node_modules/${importee}/${main}`;
+  };
+  const watcher = await watchModuleImports(buildResolver, {results: new ResultCache()});
+  try {
+    const decoder = new TextDecoder();
+    t.is(decoder.decode(await watcher.add(file)), 'import "./node_modules/x/a.js";');
+
+    const changed = new Promise((resolve) => {
+      watcher.once('change', (f, output) => resolve([f, decoder.decode(output)]));
+    });
+    fs.writeFileSync(path.join(pkg, 'package.json'), '{"main": "b.js"}');
+    t.deepEqual(await changed, [file, 'import "./node_modules/x/b.js";']);
+  } finally {
+    watcher.close();
+    fs.rmSync(dir, {recursive: true});
+  }
+});
+
+test('watch affects', (t) => {
+  t.true(affects('/p/node_modules/x/package.json', '/p/src'));
+  t.true(affects('/p/src/new.js', '/p/src'));
+  t.false(affects('/q/new.js', '/p/src'));
+});
+
+test('watch resolver dirs', (t) => {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'blep-watch-'));
+  const main = path.join(dir, 'node_modules', '@s', 'x', 'lib', 'main.js');
+  fs.mkdirSync(path.dirname(main), {recursive: true});
+  fs.writeFileSync(main, '');
+  try {
+    const dirs = resolverDirs(path.join(dir, 'a.js'), './node_modules/@s/x/lib/main.js');
+    t.true(dirs.includes(path.join(dir, 'node_modules')));
+    t.true(dirs.includes(path.dirname(main)));
+    t.true(dirs.includes(path.join(dir, 'node_modules', '@s', 'x')));
+    t.false(dirs.includes(path.join(dir, 'missing')));
+  } finally {
+    fs.rmSync(dir, {recursive: true});
+  }
+});
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+
+import {buildMangler} from '../../src/tool/mangle/lib.js';
+import buildHarness from '../harness/node-harness.js';
+
+import test from 'ava';
+
+const harness = await buildHarness();
+const decoder = new TextDecoder();
+
+test.serial('mangle', (t) => {
+  const mangle = buildMangler(harness);
+  harness.prepareString('import {a as value} from "x"; export const keep = 1; let local = value; function add(left, {right}) { var sum = left + right; return sum + local; } export {local as exported}; ({local, add});');
+  t.is(decoder.decode(mangle()), 'import {a as t} from "x"; export const keep = 1; let e = t; function n(t, {right: r}) { var i = t + r; return i + e; } export {e as exported}; ({local: e, add: n});');
+});
+
+test.serial('mangle script with eval', (t) => {
+  const mangle = buildMangler(harness, {topLevel: false});
+  harness.prepareString('var global = 1; function outer(param) { let inner = param; return () => eval("inner"); } function other(param) { let inner = param * global; return inner; }');
+  t.is(decoder.decode(mangle()), 'var global = 1; function outer(param) { let inner = param; return () => eval("inner"); } function other(e) { let t = e * global; return t; }');
+});
+
+test.serial('mangle script block functions', (t) => {
+  const mangle = buildMangler(harness, {topLevel: false});
+
+  // Annex B hoists these to the function, so the name outside the block must match
+  harness.prepareString('if (x) { function hoisted() {} } hoisted(); function f() { if (x) { function g() {} } g(); }');
+  t.is(decoder.decode(mangle()), 'if (x) { function hoisted() {} } hoisted(); function f() { if (x) { function e() {} } e(); }');
+
+  harness.prepareString('function f() { var g = 1; { function g() {} g(); } return g; }');
+  t.is(decoder.decode(mangle()), 'function f() { var e = 1; { function e() {} e(); } return e; }');
+});
+
+test.serial('mangle module block functions', (t) => {
+  const mangle = buildMangler(harness);
+
+  // modules are strict, so these stay in their block
+  harness.prepareString('function f() { if (x) { function g() {} g(); } let other = 1; return other; }');
+  t.is(decoder.decode(mangle()), 'function e() { if (x) { function e() {} e(); } let t = 1; return t; }');
+});
+
+test.serial('mangle shadowed scopes', (t) => {
+  const mangle = buildMangler(harness);
+  harness.prepareString('export function f(a) { try { a(); } catch (err) { return err; } for (let i = 0; i < a; ++i) { const j = i; a += j; } class Thing {} return new Thing(); }');
+  t.is(decoder.decode(mangle()), 'export function f(e) { try { e(); } catch (e) { return e; } for (let t = 0; t < e; ++t) { const n = t; e += n; } class t {} return new t(); }');
+
+  harness.prepareString('let a = 1; { let a = 2; b(a); } c(a); function f(x) { return function inner() { return x + y; }; }');
+  t.is(decoder.decode(mangle()), 'let e = 1; { let e = 2; b(e); } c(e); function t(e) { return function inner() { return e + y; }; }');
+});
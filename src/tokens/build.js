@@ -342,8 +342,8 @@ function main() {
 
 // ${litOnly.length} candidates:
 //   ${litOnly.join(' ')}
-int consume_known_lit(char *p, uint32_t *out) {
-  char *start = p;
+int consume_known_lit(blep_char *p, uint32_t *out) {
+  blep_char *start = p;
 #define _done(len, _out) {*out=_out;return len;}
 ${renderChoice(litOnly, '  ')}
 #undef _done
@@ -358,8 +358,9 @@ ${renderChoice(litOnly, '  ')}
 #define _HELPER_H
 
 #include <stdint.h>
+#include "../core/def.h"
 
-int consume_known_lit(char *, uint32_t *);
+int consume_known_lit(blep_char *, uint32_t *);
 
 #endif//_HELPER_H
 `;
@@ -5,8 +5,8 @@
 
 // 53 candidates:
 //   as async await break case catch class const continue debugger default delete do else enum export extends false finally for from function get if implements import in instanceof interface let new null of package private protected public return set static super switch this throw true try typeof undefined var void while with yield
-int consume_known_lit(char *p, uint32_t *out) {
-  char *start = p;
+int consume_known_lit(blep_char *p, uint32_t *out) {
+  blep_char *start = p;
 #define _done(len, _out) {*out=_out;return len;}
   switch (*p++) {
   case 'a':
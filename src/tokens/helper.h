@@ -4,7 +4,8 @@
 #define _HELPER_H
 
 #include <stdint.h>
+#include "../core/def.h"
 
-int consume_known_lit(char *, uint32_t *);
+int consume_known_lit(blep_char *, uint32_t *);
 
 #endif//_HELPER_H
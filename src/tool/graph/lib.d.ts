@@ -0,0 +1,48 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+export interface Edge {
+  specifier: string;
+  kind: 'static' | 'dynamic' | 'reexport';
+}
+
+export interface GraphModule {
+  edges: (Edge & {resolved: string | undefined})[];
+  size: number;
+  error?: string;
+}
+
+/**
+ * Runs scans on a pool of workers. A worker that dies is replaced, failing the scan it was running.
+ */
+export class Pool {
+  constructor(size: number, url?: URL);
+  scan(file: string): Promise<{edges: Edge[], size: number, error?: string}>;
+  close(): Promise<void>;
+}
+
+/**
+ * Crawls the module graph from these entry files, scanning files on a pool of workers. The
+ * resolver returns the file for an import, or undefined to not follow it. With zero workers, files
+ * are scanned on this thread.
+ */
+export function crawlGraph(entries: string[], options: {
+  resolve: (importer: string, specifier: string) => Promise<string | undefined> | string | undefined,
+  workers?: number,
+}): Promise<{
+  modules: Map<string, GraphModule>,
+  stats: {files: number, bytes: number, ms: number, filesPerSecond: number},
+}>;
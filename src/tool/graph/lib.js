@@ -0,0 +1,216 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+/**
+ * @fileoverview Crawls the module graph from entry files, scanning files on a pool of workers and
+ * resolving their imports concurrently.
+ */
+
+import * as os from 'os';
+import {performance} from 'perf_hooks';
+import {Worker} from 'worker_threads';
+import buildHarness from '../../harness/node-harness.js';
+import {buildScanner} from './scan.js';
+
+/**
+ * @typedef {import('./scan.js').Edge} Edge
+ * @typedef {import('./scan.js').ScanResult & {error?: string}} WorkerResult
+ * @typedef {Edge & {resolved: string|undefined}} ResolvedEdge
+ * @typedef {{edges: ResolvedEdge[], size: number, error?: string}} GraphModule
+ */
+
+/**
+ * Runs scans on a pool of workers. A worker that dies is replaced, failing the scan it was running.
+ */
+export class Pool {
+
+  /**
+   * @param {number} size
+   * @param {URL} url of the worker script
+   */
+  constructor(size, url = new URL('./worker.js', import.meta.url)) {
+    this.url = url;
+    this.closed = false;
+
+    /** @type {Worker[]} */
+    this.workers = [];
+
+    /** @type {Worker[]} */
+    this.idle = [];
+
+    /** @type {{file: string, resolve: (result: WorkerResult) => void}[]} */
+    this.queue = [];
+
+    /** @type {Map<Worker, (result: WorkerResult) => void>} */
+    this.active = new Map();
+
+    for (let i = 0; i < size; ++i) {
+      this.spawn();
+    }
+  }
+
+  spawn() {
+    const worker = new Worker(this.url);
+    worker.on('message', (result) => this.done(worker, result));
+    worker.on('error', (e) => this.fail(worker, String(e)));
+    worker.on('exit', (code) => this.fail(worker, `worker exited with code ${code}`));
+    this.workers.push(worker);
+    this.idle.push(worker);
+  }
+
+  /**
+   * @param {string} file
+   * @return {Promise<WorkerResult>}
+   */
+  scan(file) {
+    return new Promise((resolve) => {
+      this.queue.push({file, resolve});
+      this.pump();
+    });
+  }
+
+  pump() {
+    while (this.idle.length && this.queue.length) {
+      const worker = /** @type {Worker} */ (this.idle.pop());
+      const {file, resolve} = /** @type {typeof this.queue[0]} */ (this.queue.shift());
+      this.active.set(worker, resolve);
+      worker.postMessage(file);
+    }
+  }
+
+  /**
+   * @param {Worker} worker
+   * @param {WorkerResult} result
+   */
+  done(worker, result) {
+    const resolve = this.active.get(worker);
+    if (resolve) {
+      this.active.delete(worker);
+      this.idle.push(worker);
+      resolve(result);
+    }
+    this.pump();
+  }
+
+  /**
+   * Replaces a worker which has died, failing its scan (if any).
+   *
+   * @param {Worker} worker
+   * @param {string} error
+   */
+  fail(worker, error) {
+    const index = this.workers.indexOf(worker);
+    if (this.closed || index === -1) {
+      return;  // nb. "exit" follows "error", but the worker is already gone
+    }
+    this.workers.splice(index, 1);
+    const idleIndex = this.idle.indexOf(worker);
+    if (idleIndex !== -1) {
+      this.idle.splice(idleIndex, 1);
+    }
+    worker.terminate();
+    this.spawn();
+
+    const resolve = this.active.get(worker);
+    this.active.delete(worker);
+    if (resolve) {
+      resolve({edges: [], size: 0, error});
+    }
+    this.pump();
+  }
+
+  async close() {
+    this.closed = true;
+    await Promise.all(this.workers.map((worker) => worker.terminate()));
+  }
+}
+
+/**
+ * Crawls the module graph from these entry files. Files are deduplicated by their resolved path,
+ * and those that fail to scan are included with an error.
+ *
+ * @param {string[]} entries
+ * @param {{
+ *   resolve: (importer: string, specifier: string) => Promise<string|undefined>|string|undefined,
+ *   workers?: number,
+ * }} options resolve returns the file for an import, or undefined to not follow it; with zero
+ *     workers, files are scanned on this thread
+ * @return {Promise<{modules: Map<string, GraphModule>, stats: {files: number, bytes: number, ms: number, filesPerSecond: number}}>}
+ */
+export async function crawlGraph(entries, {resolve, workers = os.cpus().length}) {
+  const start = performance.now();
+
+  /** @type {(file: string) => Promise<WorkerResult>} */
+  let scan;
+  /** @type {Pool?} */
+  let pool = null;
+  if (workers > 0) {
+    pool = new Pool(workers);
+    scan = pool.scan.bind(pool);
+  } else {
+    const scanner = buildScanner(await buildHarness());
+    scan = async (file) => {
+      try {
+        return scanner(file);
+      } catch (e) {
+        return {edges: [], size: 0, error: String(e)};
+      }
+    };
+  }
+
+  /** @type {Map<string, GraphModule>} */
+  const modules = new Map();
+  const seen = new Set(entries);
+  let bytes = 0;
+
+  /**
+   * @param {string} file
+   * @return {Promise<void>}
+   */
+  const visit = async (file) => {
+    const {edges, size, error} = await scan(file);
+    bytes += size;
+
+    const resolved = await Promise.all(edges.map(async (edge) => {
+      return {...edge, resolved: await resolve(file, edge.specifier)};
+    }));
+    modules.set(file, {edges: resolved, size, ...(error ? {error} : {})});
+
+    /** @type {Promise<void>[]} */
+    const next = [];
+    for (const {resolved: target} of resolved) {
+      if (target !== undefined && !seen.has(target)) {
+        seen.add(target);
+        next.push(visit(target));
+      }
+    }
+    await Promise.all(next);
+  };
+
+  try {
+    await Promise.all([...seen].map(visit));
+  } finally {
+    if (pool) {
+      await pool.close();
+    }
+  }
+
+  const ms = performance.now() - start;
+  return {
+    modules,
+    stats: {files: modules.size, bytes, ms, filesPerSecond: modules.size / (ms / 1000)},
+  };
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+/**
+ * @fileoverview Finds the modules a file depends on, labelled by how they're imported.
+ */
+
+import * as blep from '../../harness/types/index.js';
+import * as common from '../../harness/common.js';
+import * as fs from 'fs';
+
+/**
+ * @typedef {{specifier: string, kind: 'static'|'dynamic'|'reexport'}} Edge
+ * @typedef {{edges: Edge[], size: number}} ScanResult
+ */
+
+/**
+ * Builds a scanner over a harness. Static imports and reexports are external strings inside
+ * module stacks (i.e., "import ... from" or "export ... from"), and dynamic imports are calls to
+ * `import()` with just a string.
+ *
+ * @param {blep.Harness} harness
+ * @return {(file: string) => ScanResult}
+ */
+export function buildScanner(harness) {
+  const {token} = harness;
+
+  return (file) => {
+    const fd = fs.openSync(file, 'r');
+    const {size} = fs.fstatSync(fd);
+    const buffer = harness.prepare(size);
+    fs.readSync(fd, buffer, 0, size, 0);
+    fs.closeSync(fd);
+
+    /** @type {Edge[]} */
+    const edges = [];
+
+    /** @type {'static'|'reexport'} */
+    let kind = 'static';
+    let moduleStart = false;
+
+    // tracks "import", "(", string, ")" for dynamic imports
+    let dynamicState = 0;
+    let dynamicSpecifier = '';
+
+    harness.handle({
+      callback() {
+        const type = token.type();
+
+        if (moduleStart) {
+          kind = token.special() === common.lit.EXPORT ? 'reexport' : 'static';
+          moduleStart = false;
+        }
+        if (type === common.types.string && token.special() === common.specials.external) {
+          edges.push({specifier: token.stringValue(), kind});
+        }
+
+        switch (dynamicState) {
+          case 2:
+            if (type === common.types.string) {
+              try {
+                dynamicSpecifier = token.stringValue();
+                dynamicState = 3;
+                return;
+              } catch (e) {
+                // template with holes
+              }
+            }
+            break;
+
+          case 3:
+            if (type === common.types.close) {
+              edges.push({specifier: dynamicSpecifier, kind: 'dynamic'});
+            }
+            break;
+
+          case 1:
+            if (type === common.types.paren) {
+              dynamicState = 2;
+              return;
+            }
+            break;
+        }
+        // nb. "import" as a call is a plain symbol, not the keyword
+        dynamicState = (type === common.types.symbol && token.length() === 6 && token.string() === 'import') ? 1 : 0;
+      },
+
+      open(type) {
+        moduleStart = (type === common.stacks.module);
+      },
+    });
+    harness.run();
+
+    return {edges, size};
+  };
+}
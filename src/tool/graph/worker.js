@@ -0,0 +1,35 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+/**
+ * @fileoverview Worker which scans files for their dependencies, for the graph crawler.
+ */
+
+import {parentPort} from 'worker_threads';
+import buildHarness from '../../harness/node-harness.js';
+import {buildScanner} from './scan.js';
+
+const scan = buildScanner(await buildHarness());
+
+/** @type {import('worker_threads').MessagePort} */ (parentPort).on('message', (file) => {
+  let message;
+  try {
+    message = scan(file);
+  } catch (e) {
+    message = {edges: [], size: 0, error: String(e)};
+  }
+  /** @type {import('worker_threads').MessagePort} */ (parentPort).postMessage(message);
+});
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+/**
+ * @fileoverview Memoizes import resolution across files, keyed by the importer's directory and
+ * the specifier, as files in the same directory resolve specifiers identically.
+ */
+
+import * as path from 'path';
+
+const DEFAULT_MAX = 16384;
+
+/**
+ * @template T
+ */
+export class ResolverCache {
+
+  /**
+   * @param {number} max entries to keep, evicting the least recently used
+   */
+  constructor(max = DEFAULT_MAX) {
+    this.max = max;
+
+    /** @type {Map<string, T>} */
+    this.entries = new Map();
+    this.hits = 0;
+    this.misses = 0;
+  }
+
+  /**
+   * Wraps a resolver builder so lookups are served from this cache. The inner builder is only
+   * called for a file when one of its lookups misses. Promises are cached as-is, so concurrent
+   * lookups share one resolution, but are dropped if they reject.
+   *
+   * @param {(importer: string) => (importee: string) => T} buildResolver
+   * @return {(importer: string) => (importee: string) => T}
+   */
+  wrap(buildResolver) {
+    return (importer) => {
+      const dir = path.dirname(importer);
+
+      /** @type {((importee: string) => T)?} */
+      let resolver = null;
+
+      return (importee) => {
+        const key = `${dir}\0${importee}`;
+        if (this.entries.has(key)) {
+          const out = /** @type {T} */ (this.entries.get(key));
+          ++this.hits;
+
+          // bump to most recently used
+          this.entries.delete(key);
+          this.entries.set(key, out);
+          return out;
+        }
+
+        ++this.misses;
+        resolver = resolver || buildResolver(importer);
+        const out = resolver(importee);
+        this.entries.set(key, out);
+
+        if (out instanceof Promise) {
+          out.catch(() => {
+            if (this.entries.get(key) === out) {
+              this.entries.delete(key);
+            }
+          });
+        }
+
+        // evict the oldest (first) entries
+        for (const k of this.entries.keys()) {
+          if (this.entries.size <= this.max) {
+            break;
+          }
+          this.entries.delete(k);
+        }
+        return out;
+      };
+    };
+  }
+
+  /**
+   * Drops cached resolutions, e.g. in watch mode when files are added or removed. Without a
+   * filter, drops everything.
+   *
+   * @param {(dir: string, importee: string) => boolean} [filter] whether to drop this entry
+   */
+  invalidate(filter) {
+    if (!filter) {
+      this.entries.clear();
+      return;
+    }
+    for (const key of this.entries.keys()) {
+      const split = key.indexOf('\0');
+      if (filter(key.substr(0, split), key.substr(split + 1))) {
+        this.entries.delete(key);
+      }
+    }
+  }
+
+  /**
+   * @return {{hits: number, misses: number, size: number}}
+   */
+  stats() {
+    return {hits: this.hits, misses: this.misses, size: this.entries.size};
+  }
+}
@@ -14,6 +14,89 @@
  * the License.
  */
 
+import {EventEmitter} from 'events';
+
+export class ResolverCache<T> {
+  constructor(max?: number);
+
+  /**
+   * Wraps a resolver builder so lookups are served from this cache, keyed by the importer's
+   * directory and the specifier. Promises are cached as-is, but dropped if they reject.
+   */
+  wrap(buildResolver: (importer: string) => ((importee: string) => T)): (importer: string) => ((importee: string) => T);
+
+  /**
+   * Drops cached resolutions, e.g. in watch mode. Without a filter, drops everything.
+   */
+  invalidate(filter?: (dir: string, importee: string) => boolean): void;
+
+  stats(): {hits: number, misses: number, size: number};
+}
+
+export class ResultCache {
+
+  /**
+   * @param options.maxBytes of output to hold in memory, evicting the least recently used
+   * @param options.dir to also store output on disk, which is checked on a memory miss
+   * @param options.fingerprint of whatever resolves imports, which changes all keys
+   */
+  constructor(options?: Partial<{maxBytes: number, dir: string|null, fingerprint: string}>);
+
+  key(file: string, source: Uint8Array): string;
+
+  /**
+   * Returns previous output for this key, which must not be modified.
+   */
+  get(key: string): Uint8Array|undefined;
+
+  set(key: string, output: Uint8Array): void;
+
+  /**
+   * Drops all output held in memory (but not on disk).
+   */
+  clear(): void;
+
+  stats(): {hits: number, misses: number, diskHits: number, hitRate: number, entries: number, bytes: number};
+}
+
+/**
+ * Watches rewritten files. Emits "change" with (file, output) when a tracked file's output changes,
+ * "remove" with (file) when it's deleted, and "error" with (error, file) if rewriting fails.
+ */
+export class ImportsWatcher extends EventEmitter {
+  constructor(
+    rewrite: (file: string) => Promise<Uint8Array>,
+    options?: Partial<{cache: ResolverCache<any>|null, delay: number}>,
+  );
+
+  /**
+   * Rewrites and starts tracking a file.
+   */
+  add(file: string): Promise<Uint8Array>;
+
+  /**
+   * Returns the last output for this file, if tracked.
+   */
+  output(file: string): Uint8Array|undefined;
+
+  close(): void;
+}
+
+export interface RewriterOptions<T> {
+
+  /**
+   * Cache shared across files (and optionally across rewriters), or null to disable. By default,
+   * each rewriter has its own.
+   */
+  cache: ResolverCache<T>|null;
+
+  /**
+   * Caches output by file path and content, so unchanged files aren't parsed again. Its
+   * fingerprint should change whenever resolution would.
+   */
+  results: ResultCache|null;
+}
+
 /**
  * Builds a method which rewrites imports from a passed filename into ESM found inside node_modules.
  * Requires a helper which builds a resolver for files.
@@ -22,4 +105,24 @@
  */
 export default function buildModuleImportRewriter(
   buildResolver: (importer: string) => ((importee: string) => string|undefined),
+  options?: Partial<RewriterOptions<string|undefined>>,
 ): Promise<(file: string, write: (part: Uint8Array) => void) => void>;
+
+/**
+ * Builds an async method which rewrites imports, as above. Each file is parsed once to collect all
+ * of its specifiers, which are then resolved concurrently, before the results are spliced in. The
+ * output is a copy, so it remains valid as other files are rewritten.
+ */
+export function buildAsyncModuleImportRewriter(
+  buildResolver: (importer: string) => ((importee: string) => Promise<string|undefined>|string|undefined),
+  options?: Partial<RewriterOptions<Promise<string|undefined>|string|undefined>>,
+): Promise<(file: string) => Promise<Uint8Array>>;
+
+/**
+ * Builds a watcher over the async rewriter, sharing its resolver cache so that resolutions can be
+ * invalidated as files are added or removed.
+ */
+export function watchModuleImports(
+  buildResolver: (importer: string) => ((importee: string) => Promise<string|undefined>|string|undefined),
+  options?: Partial<{results: ResultCache|null, delay: number}>,
+): Promise<ImportsWatcher>;
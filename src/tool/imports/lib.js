@@ -14,9 +14,16 @@
  * the License.
  */
 
+import * as blep from '../../harness/types/index.js';
 import * as common from '../../harness/common.js';
 import buildHarness from '../../harness/node-harness.js';
 import rewriter from '../../harness/node-rewriter.js';
+import * as fs from 'fs';
+import {ResolverCache} from './cache.js';
+import {ResultCache} from './result-cache.js';
+import {ImportsWatcher} from './watch.js';
+
+export {ResolverCache, ResultCache, ImportsWatcher};
 
 // Set to true to allow all stacks to be parsed (even though we don't need to as modules are
 // top-level). Useful for debugging.
@@ -27,22 +34,52 @@ const allowAllStack = false;
  */
 const stack = allowAllStack ? () => true : (type) => type === common.stacks.module;
 
+/**
+ * @param {blep.Token} token
+ * @return {boolean} whether this is an import or export specifier
+ */
+const isSpecifier = (token) => {
+  return token.special() === common.specials.external && token.type() === common.types.string;
+};
+
 /**
  * Builds a method which rewrites imports from a passed filename into ESM found inside node_modules.
  *
  * This emits relative paths to node_modules, rather than absolute ones.
  *
+ * Resolutions are cached across files by directory and specifier. Pass a shared `cache` to inspect
+ * or invalidate it, or `null` to disable caching. Pass `results` to also cache output by content,
+ * so unchanged files aren't parsed again: its fingerprint should change with the resolver.
+ *
  * @param {(importer: string) => (importee: string) => string|undefined} buildResolver
+ * @param {{cache?: ResolverCache<string|undefined>?, results?: ResultCache?}} options
  * @return {Promise<(file: string, write: (part: Uint8Array) => void) => void>}
  */
-export default async function buildModuleImportRewriter(buildResolver) {
+export default async function buildModuleImportRewriter(buildResolver, {cache = new ResolverCache(), results = null} = {}) {
+  if (cache) {
+    buildResolver = cache.wrap(buildResolver);
+  }
   const harness = await buildHarness();
   const {token, run} = rewriter(harness);
 
   return (f, write) => {
+    /** @type {Buffer|undefined} */
+    let source;
+    let key = '';
+    if (results) {
+      // read once, so the source that's hashed is the source that's parsed
+      source = fs.readFileSync(f);
+      key = results.key(f, source);
+      const cached = results.get(key);
+      if (cached) {
+        write(cached);
+        return;
+      }
+    }
+
     const resolver = buildResolver(f);
     const callback = () => {
-      if (!(token.special() === common.specials.external && token.type() === common.types.string)) {
+      if (!isSpecifier(token)) {
         return;
       }
       const out = resolver(token.stringValue());
@@ -50,6 +87,101 @@ export default async function buildModuleImportRewriter(buildResolver) {
         return JSON.stringify(out);
       }
     };
-    return run(f, {callback, stack, write});
+    const out = run(f, {callback, stack, write, source});
+    if (results) {
+      results.set(key, out);
+    }
+  };
+}
+
+/**
+ * Builds an async method which rewrites imports, as above. Each file is parsed once to collect all
+ * of its specifiers, which are then resolved concurrently, before the results are spliced in.
+ *
+ * @param {(importer: string) => (importee: string) => Promise<string|undefined>|string|undefined} buildResolver
+ * @param {{cache?: ResolverCache<Promise<string|undefined>|string|undefined>?, results?: ResultCache?}} options
+ * @return {Promise<(file: string, options?: {fresh?: boolean}) => Promise<Uint8Array>>} pass
+ *     `fresh` to skip (but still update) cached output
+ */
+export async function buildAsyncModuleImportRewriter(buildResolver, {cache = new ResolverCache(), results = null} = {}) {
+  if (cache) {
+    buildResolver = cache.wrap(buildResolver);
+  }
+  const harness = await buildHarness();
+  const {token} = harness;
+
+  return async (f, {fresh = false} = {}) => {
+    // nb. Keep our own copy of the source: the harness is shared, so other files may be parsed
+    // while this one is resolving.
+    const source = await fs.promises.readFile(f);
+    const key = results ? results.key(f, source) : '';
+    const cached = results && !fresh ? results.get(key) : undefined;
+    if (cached) {
+      return cached;
+    }
+    const resolver = buildResolver(f);
+
+    /** @type {{at: number, length: number, specifier: string}[]} */
+    const found = [];
+    harness.prepare(source.length).set(source);
+    harness.handle({
+      callback() {
+        if (isSpecifier(token)) {
+          found.push({at: token.at(), length: token.length(), specifier: token.stringValue()});
+        }
+      },
+      open: stack,
+    });
+    harness.run();
+
+    const resolved = await Promise.all(found.map(({specifier}) => resolver(specifier)));
+
+    // This part is synchronous, so the harness is ours until the output is copied out.
+    harness.prepare(source.length).set(source);
+    found.forEach(({at, length}, i) => {
+      const out = resolved[i];
+      if (out && typeof out === 'string') {
+        harness.addSplice(at, length, JSON.stringify(out));
+      }
+    });
+    const out = harness.assemble().slice();
+    if (results) {
+      results.set(key, out);
+    }
+    return out;
+  };
+}
+
+/**
+ * Builds a watcher over the async rewriter, sharing its resolver cache so that resolutions can be
+ * invalidated as files are added or removed, or packages change. The directories each resolution
+ * reads (node_modules, and the resolved package) are watched too. Call `add()` on the watcher for
+ * each file to track.
+ *
+ * @param {(importer: string) => (importee: string) => Promise<string|undefined>|string|undefined} buildResolver
+ * @param {{results?: ResultCache?, delay?: number}} options
+ * @return {Promise<ImportsWatcher>}
+ */
+export async function watchModuleImports(buildResolver, {results = null, delay} = {}) {
+  const cache = new ResolverCache();
+
+  /** @type {ImportsWatcher} */
+  let watcher;
+  /** @type {typeof buildResolver} */
+  const trackedResolver = (importer) => {
+    const resolver = buildResolver(importer);
+    return (importee) => {
+      const out = resolver(importee);
+      if (out instanceof Promise) {
+        out.then((resolved) => watcher.resolved(importer, resolved), () => {});
+      } else {
+        watcher.resolved(importer, out);
+      }
+      return out;
+    };
   };
+
+  const rewrite = await buildAsyncModuleImportRewriter(trackedResolver, {cache, results});
+  watcher = new ImportsWatcher(rewrite, {cache, delay});
+  return watcher;
 }
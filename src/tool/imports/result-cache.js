@@ -0,0 +1,157 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+/**
+ * @fileoverview Caches rewritten output by content, so unchanged files skip parsing entirely.
+ */
+
+import * as crypto from 'crypto';
+import * as fs from 'fs';
+import * as path from 'path';
+
+const DEFAULT_MAX_BYTES = 64 * 1024 * 1024;
+
+export class ResultCache {
+
+  /**
+   * @param {Partial<{maxBytes: number, dir: string?, fingerprint: string}>} options
+   */
+  constructor({maxBytes = DEFAULT_MAX_BYTES, dir = null, fingerprint = ''} = {}) {
+    this.maxBytes = maxBytes;
+    this.dir = dir;
+    this.fingerprint = fingerprint;
+
+    /** @type {Map<string, Uint8Array>} */
+    this.entries = new Map();
+    this.bytes = 0;
+    this.hits = 0;
+    this.misses = 0;
+    this.diskHits = 0;
+
+    if (dir) {
+      fs.mkdirSync(dir, {recursive: true});
+    }
+  }
+
+  /**
+   * Builds the key for a file's source. This includes the file's path, as output depends on where
+   * the importer is (e.g., relative paths), and the fingerprint of whatever resolves imports.
+   *
+   * @param {string} file
+   * @param {Uint8Array} source
+   * @return {string}
+   */
+  key(file, source) {
+    const hash = crypto.createHash('sha1');
+    hash.update(`${this.fingerprint}\0${file}\0`);
+    hash.update(source);
+    return hash.digest('hex');
+  }
+
+  /**
+   * Returns previous output for this key, which must not be modified, or undefined.
+   *
+   * @param {string} key
+   * @return {Uint8Array|undefined}
+   */
+  get(key) {
+    let out = this.entries.get(key);
+    if (out !== undefined) {
+      // bump to most recently used
+      this.entries.delete(key);
+      this.entries.set(key, out);
+      ++this.hits;
+      return out;
+    }
+
+    if (this.dir) {
+      try {
+        out = fs.readFileSync(path.join(this.dir, key));
+      } catch (e) {
+        // not found
+      }
+      if (out !== undefined) {
+        this.store(key, out);
+        ++this.hits;
+        ++this.diskHits;
+        return out;
+      }
+    }
+
+    ++this.misses;
+    return undefined;
+  }
+
+  /**
+   * Stores a copy of the output for this key.
+   *
+   * @param {string} key
+   * @param {Uint8Array} output
+   */
+  set(key, output) {
+    const copy = output.slice();
+    this.store(key, copy);
+    if (this.dir) {
+      fs.writeFileSync(path.join(this.dir, key), copy);
+    }
+  }
+
+  /**
+   * @param {string} key
+   * @param {Uint8Array} output
+   */
+  store(key, output) {
+    const prev = this.entries.get(key);
+    if (prev !== undefined) {
+      this.bytes -= prev.length;
+      this.entries.delete(key);
+    }
+    this.entries.set(key, output);
+    this.bytes += output.length;
+
+    // evict the oldest (first) entries
+    for (const [k, v] of this.entries) {
+      if (this.bytes <= this.maxBytes) {
+        break;
+      }
+      this.entries.delete(k);
+      this.bytes -= v.length;
+    }
+  }
+
+  /**
+   * Drops all output held in memory (but not on disk).
+   */
+  clear() {
+    this.entries.clear();
+    this.bytes = 0;
+  }
+
+  /**
+   * @return {{hits: number, misses: number, diskHits: number, hitRate: number, entries: number, bytes: number}}
+   */
+  stats() {
+    const total = this.hits + this.misses;
+    return {
+      hits: this.hits,
+      misses: this.misses,
+      diskHits: this.diskHits,
+      hitRate: total ? this.hits / total : 0,
+      entries: this.entries.size,
+      bytes: this.bytes,
+    };
+  }
+}
@@ -0,0 +1,251 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+/**
+ * @fileoverview Watches rewritten files, and rewrites again only those which change or whose
+ * imports may now resolve differently.
+ */
+
+import * as fs from 'fs';
+import * as path from 'path';
+import {EventEmitter} from 'events';
+
+const NODE_MODULES = `${path.sep}node_modules${path.sep}`;
+
+/**
+ * Whether adding or removing this path could change resolutions made from this directory: either
+ * it's below the directory (e.g., a relative import), or in a node_modules which the directory
+ * would search (e.g., a new package.json).
+ *
+ * @param {string} changed
+ * @param {string} dir
+ * @return {boolean}
+ */
+export function affects(changed, dir) {
+  if (changed.startsWith(dir + path.sep)) {
+    return true;
+  }
+  const index = changed.indexOf(NODE_MODULES);
+  if (index === -1) {
+    return false;
+  }
+  const root = changed.substr(0, index);
+  return dir === root || dir.startsWith(root + path.sep);
+}
+
+/**
+ * Returns the directories a Node-style resolver reads for a resolution from importer: each
+ * node_modules it searches, and for a resolved file on disk, its directory and package (with its
+ * package.json). Only those which exist are returned.
+ *
+ * @param {string} importer
+ * @param {string=} resolved relative to the importer, or absolute
+ * @return {string[]}
+ */
+export function resolverDirs(importer, resolved) {
+  /** @type {string[]} */
+  const dirs = [];
+  for (let dir = path.dirname(importer); ; dir = path.dirname(dir)) {
+    dirs.push(path.join(dir, 'node_modules'));
+    if (dir === path.dirname(dir)) {
+      break;
+    }
+  }
+
+  if (typeof resolved === 'string' && resolved) {
+    const file = path.resolve(path.dirname(importer), resolved);
+    if (fs.existsSync(file)) {
+      dirs.push(path.dirname(file));
+
+      // the package root is the part after the last node_modules (and any @scope)
+      const index = file.lastIndexOf(NODE_MODULES);
+      if (index !== -1) {
+        const parts = file.substr(index + NODE_MODULES.length).split(path.sep);
+        const length = parts[0].startsWith('@') ? 2 : 1;
+        if (parts.length > length) {
+          dirs.push(file.substr(0, index + NODE_MODULES.length) + parts.slice(0, length).join(path.sep));
+        }
+      }
+    }
+  }
+
+  return dirs.filter((dir) => fs.existsSync(dir));
+}
+
+/**
+ * Emits "change" with (file, output) when a tracked file's output changes, "remove" with (file)
+ * when it's deleted, and "error" with (error, file) if rewriting fails.
+ */
+export class ImportsWatcher extends EventEmitter {
+
+  /**
+   * @param {(file: string, options?: {fresh?: boolean}) => Promise<Uint8Array>} rewrite pass
+   *     `fresh` to skip any cached output
+   * @param {{cache?: import('./cache.js').ResolverCache<any>?, delay?: number}} options cache used
+   *     by rewrite, invalidated as files are added, removed, or packages change
+   */
+  constructor(rewrite, {cache = null, delay = 20} = {}) {
+    super();
+    this.rewrite = rewrite;
+    this.cache = cache;
+    this.delay = delay;
+
+    /** @type {Map<string, Uint8Array>} */
+    this.outputs = new Map();
+
+    /** @type {Map<string, fs.FSWatcher>} */
+    this.watchers = new Map();
+
+    /** @type {Set<string>} */
+    this.pending = new Set();
+
+    /** @type {NodeJS.Timeout?} */
+    this.timeout = null;
+    this.closed = false;
+  }
+
+  /**
+   * Rewrites and starts tracking a file.
+   *
+   * @param {string} file
+   * @return {Promise<Uint8Array>}
+   */
+  async add(file) {
+    file = path.resolve(file);
+    const output = await this.rewrite(file);
+    this.outputs.set(file, output);
+    this.watchDir(path.dirname(file));
+    return output;
+  }
+
+  /**
+   * Watches the directories read to resolve a specifier, as reported by the resolver.
+   *
+   * @param {string} importer
+   * @param {string=} resolved
+   */
+  resolved(importer, resolved) {
+    resolverDirs(importer, resolved).forEach((dir) => this.watchDir(dir));
+  }
+
+  /**
+   * @param {string} dir
+   */
+  watchDir(dir) {
+    if (this.closed || this.watchers.has(dir)) {
+      return;
+    }
+    const watcher = fs.watch(dir, (type, filename) => {
+      if (filename) {
+        this.onEvent(type, path.join(dir, filename.toString()));
+      }
+    });
+    watcher.on('error', () => {
+      // e.g., the directory was removed
+      watcher.close();
+      this.watchers.delete(dir);
+    });
+    this.watchers.set(dir, watcher);
+  }
+
+  /**
+   * @param {string} file
+   * @return {Uint8Array|undefined} last output for this file, if tracked
+   */
+  output(file) {
+    return this.outputs.get(path.resolve(file));
+  }
+
+  close() {
+    this.closed = true;
+    for (const watcher of this.watchers.values()) {
+      watcher.close();
+    }
+    this.watchers.clear();
+    this.outputs.clear();
+    this.pending.clear();
+    if (this.timeout) {
+      clearTimeout(this.timeout);
+      this.timeout = null;
+    }
+  }
+
+  /**
+   * @param {string} type
+   * @param {string} changed
+   */
+  onEvent(type, changed) {
+    if (type === 'rename' || path.basename(changed) === 'package.json') {
+      // Something was added or removed, or a package changed: drop resolutions it could affect,
+      // and rewrite the files which made them.
+      /** @type {Set<string>} */
+      const dirs = new Set();
+      if (this.cache) {
+        this.cache.invalidate((dir) => {
+          if (!affects(changed, dir)) {
+            return false;
+          }
+          dirs.add(dir);
+          return true;
+        });
+      }
+      for (const file of this.outputs.keys()) {
+        if (dirs.has(path.dirname(file))) {
+          this.pending.add(file);
+        }
+      }
+    }
+
+    if (this.outputs.has(changed)) {
+      this.pending.add(changed);
+    }
+    if (this.pending.size && !this.timeout) {
+      this.timeout = setTimeout(() => this.flush(), this.delay);
+    }
+  }
+
+  async flush() {
+    this.timeout = null;
+    const files = [...this.pending];
+    this.pending.clear();
+
+    await Promise.all(files.map(async (file) => {
+      if (!fs.existsSync(file)) {
+        this.outputs.delete(file);
+        this.emit('remove', file);
+        return;
+      }
+
+      // nb. The source may be unchanged, but its resolutions not, so skip any cached output.
+      let output;
+      try {
+        output = await this.rewrite(file, {fresh: true});
+      } catch (e) {
+        this.emit('error', e, file);
+        return;
+      }
+
+      const prev = this.outputs.get(file);
+      if (!this.outputs.has(file)) {
+        return;  // closed while rewriting
+      } else if (prev && Buffer.compare(prev, output) === 0) {
+        return;
+      }
+      this.outputs.set(file, output);
+      this.emit('change', file, output);
+    }));
+  }
+}
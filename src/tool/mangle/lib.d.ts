@@ -0,0 +1,29 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+import * as blep from '../../harness/types/index.js';
+
+/**
+ * Builds a mangler over this harness, which renames local bindings to short names. Exported names
+ * and properties are left alone. Set `topLevel` false for classic scripts, whose top-level
+ * bindings are globals.
+ *
+ * The returned function mangles the prepared source and returns the output, a view into memory
+ * valid until the next prepare.
+ */
+export function buildMangler<T extends Uint8Array|Uint16Array>(harness: blep.Harness<T>, options?: {
+  topLevel?: boolean,
+}): () => T;
@@ -0,0 +1,345 @@
+/*
+ * Copyright 2021 Sam Thorogood.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+/**
+ * @fileoverview Renames local bindings to short names, using the declarations the parser reports.
+ */
+
+import * as blep from '../../harness/types/index.js';
+import * as common from '../../harness/common.js';
+
+/**
+ * @typedef {{
+ *   name: string,
+ *   scope: Scope,
+ *   count: number,
+ *   keep: boolean,
+ *   rename: string,
+ * }}
+ * Binding
+ *
+ * @typedef {{
+ *   parent: Scope?,
+ *   fn: Scope,
+ *   bindings: Map<string, Binding>,
+ *   children: Scope[],
+ *   outer: Set<Binding>,
+ *   unsafe: boolean,
+ * }}
+ * Scope
+ *
+ * @typedef {{scope: Scope, name: string, binding?: Binding, external: boolean, shorthand: boolean}} Ref
+ */
+
+const reservedWords = new Set(`
+await break case catch class const continue debugger default delete do else enum export extends
+false finally for function if implements import in instanceof interface let new null package
+private protected public return static super switch this throw true try typeof var void while
+with yield arguments eval undefined NaN Infinity
+`.trim().split(/\s+/));
+
+// roughly by frequency in source, so short names compress well
+const firstChars = 'etnrisoauclpdfmhgbvywkxjqzETNRISOAUCLPDFMHGBVYWKXJQZ$_';
+const restChars = firstChars + '0123456789';
+
+/**
+ * @param {number} i
+ * @return {string}
+ */
+function nameFor(i) {
+  let out = firstChars[i % firstChars.length];
+  i = Math.floor(i / firstChars.length);
+  while (i > 0) {
+    --i;
+    out += restChars[i % restChars.length];
+    i = Math.floor(i / restChars.length);
+  }
+  return out;
+}
+
+/**
+ * @param {Scope?} parent
+ * @param {boolean} fn whether this holds "var" declarations
+ * @return {Scope}
+ */
+function createScope(parent, fn) {
+  /** @type {Scope} */
+  const scope = {
+    parent,
+    fn: /** @type {Scope} */ (fn ? null : parent?.fn),
+    bindings: new Map(),
+    children: [],
+    outer: new Set(),
+    unsafe: false,
+  };
+  if (fn) {
+    scope.fn = scope;
+  }
+  parent?.children.push(scope);
+  return scope;
+}
+
+/**
+ * Builds a mangler over a harness. Declarations are symbols with `declare`, which go to the
+ * nearest function scope if also `top` (i.e., var-like), and otherwise the nearest block. Every
+ * other symbol is resolved up the scope chain once the source is read, and bindings are renamed
+ * most-used first, skipping names visible to their references.
+ *
+ * Bindings stay as-is if exported (`external`), or in a scope that might see a direct `eval` or
+ * `with`. Properties are never renamed, and shorthands such as `{x}` are expanded.
+ *
+ * The source is parsed twice: once to find bindings and once to splice renames in order, along
+ * with any defines.
+ *
+ * @template {Uint8Array|Uint16Array} T
+ * @param {blep.Harness<T>} harness
+ * @param {{topLevel?: boolean}} options set `topLevel` false for classic scripts, whose top-level
+ *     bindings are globals, and whose function declarations in blocks may be hoisted
+ * @return {() => T} mangles the prepared source, returning a view valid until the next prepare
+ */
+export function buildMangler(harness, {topLevel = true} = {}) {
+  const {token} = harness;
+  const {types, specials, stacks, lit} = common;
+
+  return () => {
+    const root = createScope(null, true);
+    let scope = root;
+
+    // parallel stacks of open stack types and whether each opened a scope
+    /** @type {number[]} */
+    const openTypes = [];
+    /** @type {boolean[]} */
+    const openScopes = [];
+
+    // open brackets, to find shorthand properties
+    /** @type {number[]} */
+    const brackets = [];
+    let afterSpread = false;
+
+    /** @type {Set<string>} */
+    const reserved = new Set(reservedWords);
+
+    /** @type {Ref[]} */
+    const refs = [];
+
+    /** @param {Scope?} s */
+    const markUnsafe = (s) => {
+      for (; s && !s.unsafe; s = s.parent) {
+        s.unsafe = true;
+      }
+    };
+
+    harness.handle({
+      callback() {
+        const type = token.type();
+        const wasSpread = afterSpread;
+        afterSpread = false;
+
+        switch (type) {
+          case types.brace:
+          case types.array:
+          case types.paren:
+          case types.ternary:
+          case types.block:
+            brackets.push(type);
+            return;
+
+          case types.close:
+            brackets.pop();
+            return;
+
+          case types.op:
+            afterSpread = (token.special() === lit.$SPREAD);
+            return;
+
+          case types.keyword:
+            if (token.special() === lit.WITH) {
+              markUnsafe(scope);
+            }
+            return;
+
+          case types.lit:
+            // names of function and class expressions, which we never rename
+            if (!(token.special() & specials.property)) {
+              reserved.add(token.string());
+            }
+            return;
+
+          case types.symbol:
+            break;
+
+          default:
+            return;
+        }
+
+        const special = token.special();
+        const name = token.string();
+
+        /** @type {Ref} */
+        const ref = {
+          scope,
+          name,
+          external: Boolean(special & specials.external),
+          shorthand: Boolean(special & specials.property) && !wasSpread && brackets[brackets.length - 1] === types.brace,
+        };
+        refs.push(ref);
+
+        if (!name) {
+          return;  // anonymous default export
+        }
+
+        if (special & specials.declare) {
+          let target = scope;
+          if (special & specials.top) {
+            target = scope.fn;
+          } else if (openTypes[openTypes.length - 1] === stacks.function) {
+            // name of a function declaration: in scripts, one in a block is also hoisted to its
+            // function (Annex B), so bind it there and both names are renamed together
+            const parent = scope.parent ?? scope;
+            target = topLevel ? parent : parent.fn;
+          }
+
+          let binding = target.bindings.get(name);
+          if (!binding) {
+            binding = {name, scope: target, count: 0, keep: false, rename: ''};
+            target.bindings.set(name, binding);
+          }
+          ref.binding = binding;
+        } else if (name === 'eval') {
+          markUnsafe(scope);
+        }
+      },
+
+      open(type) {
+        const parentType = openTypes[openTypes.length - 1];
+        let opens = false;
+
+        switch (type) {
+          case stacks.function:
+            scope = createScope(scope, true);
+            opens = true;
+            break;
+
+          case stacks.control:
+            scope = createScope(scope, false);
+            opens = true;
+            break;
+
+          case stacks.block:
+            // bodies of functions and control statements share their scope, as e.g. a "let" can't
+            // have the same name as a parameter or caught error
+            if (parentType !== stacks.function && parentType !== stacks.inner && parentType !== stacks.control) {
+              scope = createScope(scope, false);
+              opens = true;
+            }
+            break;
+        }
+
+        openTypes.push(type);
+        openScopes.push(opens);
+      },
+
+      close() {
+        openTypes.pop();
+        if (openScopes.pop()) {
+          scope = /** @type {Scope} */ (scope.parent);
+        }
+      },
+    });
+    harness.run();
+
+    // resolve every reference, and note where each binding is visible from below its scope
+    for (const ref of refs) {
+      if (!ref.name) {
+        continue;
+      }
+
+      let binding = ref.binding;
+      for (let s = /** @type {Scope?} */ (ref.scope); !binding && s; s = s.parent) {
+        binding = s.bindings.get(ref.name);
+      }
+      if (!binding) {
+        reserved.add(ref.name);  // global
+        continue;
+      }
+
+      ref.binding = binding;
+      ++binding.count;
+      binding.keep ||= ref.external;
+      for (let s = ref.scope; s !== binding.scope; s = /** @type {Scope} */ (s.parent)) {
+        s.outer.add(binding);
+      }
+    }
+
+    /** @type {Binding[]} */
+    const kept = [];
+
+    /** @param {Scope} s */
+    const findKept = (s) => {
+      for (const binding of s.bindings.values()) {
+        binding.keep ||= s.unsafe || (s === root && !topLevel) || reservedWords.has(binding.name);
+        if (binding.keep) {
+          reserved.add(binding.name);
+        }
+      }
+      s.children.forEach(findKept);
+    };
+    findKept(root);
+
+    // scopes are named top-down, so the names of outer bindings seen below are already known
+    /** @param {Scope} s */
+    const allocate = (s) => {
+      /** @type {Set<string>} */
+      const used = new Set();
+      for (const binding of s.outer) {
+        used.add(binding.rename || binding.name);
+      }
+
+      const renamed = [...s.bindings.values()].filter(({keep}) => !keep);
+      renamed.sort((a, b) => b.count - a.count);
+
+      let i = 0;
+      for (const binding of renamed) {
+        let name;
+        do {
+          name = nameFor(i++);
+        } while (reserved.has(name) || used.has(name));
+        binding.rename = name;
+      }
+
+      s.children.forEach(allocate);
+    };
+    allocate(root);
+
+    // run again to splice renames in order, as defines (if any) are spliced as they're found
+    let index = 0;
+    harness.handle({
+      callback() {
+        if (token.type() !== types.symbol) {
+          return;
+        }
+        const {binding, name, shorthand} = refs[index++];
+        if (!binding?.rename) {
+          return;
+        }
+        harness.addSplice(token.at(), token.length(), shorthand ? `${name}: ${binding.rename}` : binding.rename);
+      },
+    });
+    harness.run();
+
+    return harness.assemble();
+  };
+}